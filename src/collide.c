@@ -1,6 +1,13 @@
 #include "collide.h"
 
+#include "collide_array.h"
+#include "heap.h"
+#include "simd.h"
 
+#include <intrin.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 void set_collider(collide_t* collider, transform_t* transform) {
 	float height = transform->scale.z;
@@ -18,8 +25,10 @@ void set_collider(collide_t* collider, transform_t* transform) {
 	collider->maxX = transform->translation.x + depth;
 }
 
-int intersecting(collide_t* comp1, collide_t* comp2) {
-	if (comp1->minY <= comp2->maxY &&
+int intersecting(const collide_t* comp1, const collide_t* comp2) {
+	if (comp1->minX <= comp2->maxX &&
+		comp1->maxX >= comp2->minX &&
+		comp1->minY <= comp2->maxY &&
 		comp1->maxY >= comp2->minY &&
 		comp1->minZ <= comp2->maxZ &&
 		comp1->maxZ >= comp2->minZ
@@ -27,4 +36,246 @@ int intersecting(collide_t* comp1, collide_t* comp2) {
 		return 1;
 	}
 	return 0;
-}
\ No newline at end of file
+}
+
+void collide_to_soa(const collide_t* colliders, const collide_soa_t* result, int count) {
+	for (int i = 0; i < count; i++) {
+		result->min[0][i] = colliders[i].minX;
+		result->min[1][i] = colliders[i].minY;
+		result->min[2][i] = colliders[i].minZ;
+		result->max[0][i] = colliders[i].maxX;
+		result->max[1][i] = colliders[i].maxY;
+		result->max[2][i] = colliders[i].maxZ;
+	}
+}
+
+int intersecting_soa(const collide_t* collider, const collide_soa_t* others, int count, uint32_t* out_masks) {
+	memset(out_masks, 0, sizeof(uint32_t) * ((count + 31) / 32));
+
+	simdf_t min[3] = { simdf_set1(collider->minX), simdf_set1(collider->minY), simdf_set1(collider->minZ) };
+	simdf_t max[3] = { simdf_set1(collider->maxX), simdf_set1(collider->maxY), simdf_set1(collider->maxZ) };
+	int hits = 0;
+	for (int i = 0; i < count; i += k_simd_width) {
+		// Two boxes are apart if either one ends before the other begins on some axis.
+		int lanes = __min(count - i, k_simd_width);
+		simdm_t apart = simdf_lt(simdf_load_partial(&others->max[0][i], lanes), min[0]);
+		apart = simdm_or(apart, simdf_lt(max[0], simdf_load_partial(&others->min[0][i], lanes)));
+		for (int axis = 1; axis < 3; axis++) {
+			apart = simdm_or(apart, simdf_lt(simdf_load_partial(&others->max[axis][i], lanes), min[axis]));
+			apart = simdm_or(apart, simdf_lt(max[axis], simdf_load_partial(&others->min[axis][i], lanes)));
+		}
+
+		// k_simd_width divides 32, so a vector's bits never straddle two words.
+		uint32_t bits = ~simdm_bits(apart) & ((1u << lanes) - 1);
+		out_masks[i / 32] |= bits << (i % 32);
+		for (; bits; bits &= bits - 1) {
+			hits++;
+		}
+	}
+	return hits;
+}
+
+enum {
+	// Buckets with more entries than this are tested at SIMD width; gathering costs more for fewer.
+	k_grid_scalar_bucket = 8,
+};
+
+// One collider's place in one grid cell.
+typedef struct grid_entry_t {
+	int cell_y;
+	int cell_z;
+	int collider;
+} grid_entry_t;
+
+typedef struct collide_grid_t {
+	heap_t* heap;
+	float inverse_cell_size;
+
+	int collider_count;
+	int collider_capacity;
+	collide_t* colliders;
+
+	int entry_count;
+	int entry_capacity;
+	grid_entry_t* entries;
+	// Entries sorted by hash bucket, and where each bucket starts.
+	int sorted_capacity;
+	grid_entry_t* sorted_entries;
+	int bucket_capacity;
+	int* bucket_starts;
+
+	// Bounds of the colliders in one bucket, and the hits of one of them against the rest.
+	int bucket_soa_capacity;
+	float* bucket_bounds;
+	uint32_t* bucket_hits;
+
+	int pair_count;
+	int pair_capacity;
+	collide_pair_t* pairs;
+} collide_grid_t;
+
+static int cell_of(const collide_grid_t* grid, float position) {
+	return (int)floorf(position * grid->inverse_cell_size);
+}
+
+static int bucket_of(int cell_y, int cell_z, int bucket_mask) {
+	return (int)(((uint32_t)cell_y * 73856093u ^ (uint32_t)cell_z * 19349663u) & (uint32_t)bucket_mask);
+}
+
+collide_grid_t* collide_grid_create(heap_t* heap, float cell_size) {
+	collide_grid_t* grid = heap_alloc(heap, sizeof(collide_grid_t), 8);
+	memset(grid, 0, sizeof(*grid));
+	grid->heap = heap;
+	grid->inverse_cell_size = 1.0f / cell_size;
+	return grid;
+}
+
+void collide_grid_destroy(collide_grid_t* grid) {
+	void* arrays[] = { grid->colliders, grid->entries, grid->sorted_entries, grid->bucket_starts, grid->bucket_bounds, grid->bucket_hits, grid->pairs };
+	for (int i = 0; i < _countof(arrays); i++) {
+		if (arrays[i]) {
+			heap_free(grid->heap, arrays[i]);
+		}
+	}
+	heap_free(grid->heap, grid);
+}
+
+void collide_grid_clear(collide_grid_t* grid) {
+	grid->collider_count = 0;
+	grid->entry_count = 0;
+	grid->pair_count = 0;
+}
+
+int collide_grid_insert(collide_grid_t* grid, const collide_t* collider) {
+	int index = grid->collider_count;
+	grid->colliders = collide_grow_array(grid->heap, grid->colliders, grid->collider_count, &grid->collider_capacity, index + 1, sizeof(collide_t));
+	grid->colliders[grid->collider_count++] = *collider;
+
+	int min_y = cell_of(grid, collider->minY);
+	int max_y = cell_of(grid, collider->maxY);
+	int min_z = cell_of(grid, collider->minZ);
+	int max_z = cell_of(grid, collider->maxZ);
+	int cells = (max_y - min_y + 1) * (max_z - min_z + 1);
+	grid->entries = collide_grow_array(grid->heap, grid->entries, grid->entry_count, &grid->entry_capacity, grid->entry_count + cells, sizeof(grid_entry_t));
+	for (int y = min_y; y <= max_y; y++) {
+		for (int z = min_z; z <= max_z; z++) {
+			grid->entries[grid->entry_count++] = (grid_entry_t){ .cell_y = y, .cell_z = z, .collider = index };
+		}
+	}
+	return index;
+}
+
+// Report two intersecting colliders found in the same bucket, if they share its cell.
+static void add_pair_in_cell(collide_grid_t* grid, const grid_entry_t* first, const grid_entry_t* second) {
+	// Different cells can share a bucket.
+	if (first->cell_y != second->cell_y || first->cell_z != second->cell_z) {
+		return;
+	}
+	// Colliders spanning several cells meet in more than one; report the pair only in the
+	// cell holding the low corner of their overlap.
+	const collide_t* a = &grid->colliders[first->collider];
+	const collide_t* c = &grid->colliders[second->collider];
+	if (cell_of(grid, __max(a->minY, c->minY)) != first->cell_y || cell_of(grid, __max(a->minZ, c->minZ)) != first->cell_z) {
+		return;
+	}
+	grid->pairs = collide_grow_array(grid->heap, grid->pairs, grid->pair_count, &grid->pair_capacity, grid->pair_count + 1, sizeof(collide_pair_t));
+	grid->pairs[grid->pair_count++] = (collide_pair_t){
+		.a = __min(first->collider, second->collider),
+		.b = __max(first->collider, second->collider),
+	};
+}
+
+const collide_pair_t* collide_grid_find_pairs(collide_grid_t* grid, int* out_count) {
+	grid->pair_count = 0;
+
+	// Counting sort the entries by bucket, with at least twice as many buckets as entries.
+	int bucket_count = 16;
+	while (bucket_count < grid->entry_count * 2) {
+		bucket_count *= 2;
+	}
+	if (bucket_count + 1 > grid->bucket_capacity) {
+		if (grid->bucket_starts) {
+			heap_free(grid->heap, grid->bucket_starts);
+		}
+		grid->bucket_starts = heap_alloc(grid->heap, sizeof(int) * (bucket_count + 1), 8);
+		grid->bucket_capacity = bucket_count + 1;
+	}
+	grid->sorted_entries = collide_grow_array(grid->heap, grid->sorted_entries, 0, &grid->sorted_capacity, grid->entry_count, sizeof(grid_entry_t));
+
+	// Count into each bucket's end, then place entries back to front so each end becomes a start.
+	int* starts = grid->bucket_starts;
+	memset(starts, 0, sizeof(int) * (bucket_count + 1));
+	for (int i = 0; i < grid->entry_count; i++) {
+		starts[bucket_of(grid->entries[i].cell_y, grid->entries[i].cell_z, bucket_count - 1)]++;
+	}
+	for (int b = 1; b <= bucket_count; b++) {
+		starts[b] += starts[b - 1];
+	}
+	for (int i = grid->entry_count - 1; i >= 0; i--) {
+		const grid_entry_t* entry = &grid->entries[i];
+		grid->sorted_entries[--starts[bucket_of(entry->cell_y, entry->cell_z, bucket_count - 1)]] = *entry;
+	}
+
+	for (int b = 0; b < bucket_count; b++) {
+		int first = starts[b];
+		int count = starts[b + 1] - first;
+		const grid_entry_t* entries = &grid->sorted_entries[first];
+		if (count <= k_grid_scalar_bucket) {
+			for (int i = 0; i < count; i++) {
+				for (int j = i + 1; j < count; j++) {
+					if (intersecting(&grid->colliders[entries[i].collider], &grid->colliders[entries[j].collider])) {
+						add_pair_in_cell(grid, &entries[i], &entries[j]);
+					}
+				}
+			}
+			continue;
+		}
+
+		// Gather a crowded bucket's bounds so each entry is tested against all later ones at SIMD width.
+		if (count > grid->bucket_soa_capacity) {
+			if (grid->bucket_bounds) {
+				heap_free(grid->heap, grid->bucket_bounds);
+				heap_free(grid->heap, grid->bucket_hits);
+			}
+			grid->bucket_soa_capacity = __max(count, grid->bucket_soa_capacity * 2);
+			grid->bucket_bounds = heap_alloc(grid->heap, sizeof(float) * 6 * grid->bucket_soa_capacity, 16);
+			grid->bucket_hits = heap_alloc(grid->heap, sizeof(uint32_t) * ((grid->bucket_soa_capacity + 31) / 32), 8);
+		}
+		collide_soa_t bounds;
+		for (int axis = 0; axis < 3; axis++) {
+			bounds.min[axis] = &grid->bucket_bounds[axis * grid->bucket_soa_capacity];
+			bounds.max[axis] = &grid->bucket_bounds[(axis + 3) * grid->bucket_soa_capacity];
+		}
+		for (int i = 0; i < count; i++) {
+			const collide_t* collider = &grid->colliders[entries[i].collider];
+			bounds.min[0][i] = collider->minX;
+			bounds.min[1][i] = collider->minY;
+			bounds.min[2][i] = collider->minZ;
+			bounds.max[0][i] = collider->maxX;
+			bounds.max[1][i] = collider->maxY;
+			bounds.max[2][i] = collider->maxZ;
+		}
+
+		for (int i = 0; i < count - 1; i++) {
+			collide_soa_t later;
+			for (int axis = 0; axis < 3; axis++) {
+				later.min[axis] = bounds.min[axis] + i + 1;
+				later.max[axis] = bounds.max[axis] + i + 1;
+			}
+			int later_count = count - i - 1;
+			if (!intersecting_soa(&grid->colliders[entries[i].collider], &later, later_count, grid->bucket_hits)) {
+				continue;
+			}
+			for (int word = 0; word < (later_count + 31) / 32; word++) {
+				for (uint32_t bits = grid->bucket_hits[word]; bits; bits &= bits - 1) {
+					unsigned long bit;
+					_BitScanForward(&bit, bits);
+					add_pair_in_cell(grid, &entries[i], &entries[i + 1 + word * 32 + (int)bit]);
+				}
+			}
+		}
+	}
+
+	*out_count = grid->pair_count;
+	return grid->pairs;
+}
@@ -1,5 +1,11 @@
+#pragma once
+
 #include "transform.h"
 
+#include <stdint.h>
+
+typedef struct heap_t heap_t;
+
 // Collider object
 typedef struct collide_t {
 	float width;
@@ -16,5 +22,50 @@ typedef struct collide_t {
 // Set the collider object using a transform
 void set_collider(collide_t* collider, transform_t* transform);
 
-// Check if two colliders are intersecting
-int intersecting(collide_t* comp1, collide_t* comp2);
\ No newline at end of file
+// Check if two colliders are intersecting on all three axes
+int intersecting(const collide_t* comp1, const collide_t* comp2);
+
+// Collider bounds stored as one array per field, for testing many colliders at once.
+// Each array holds one value per collider: min[0] is every minimum X, min[1] every minimum Y, and so on.
+typedef struct collide_soa_t {
+	float* min[3];
+	float* max[3];
+} collide_soa_t;
+
+// Copy the bounds of count colliders into arrays.
+void collide_to_soa(const collide_t* colliders, const collide_soa_t* result, int count);
+
+// Test one collider against count others, k_simd_width at a time (see simd.h).
+// Sets bit i % 32 of out_masks[i / 32] where the collider intersects other i, as intersecting() would,
+// and clears the bits of the rest. out_masks needs (count + 31) / 32 words.
+// Returns the number of intersections.
+int intersecting_soa(const collide_t* collider, const collide_soa_t* others, int count, uint32_t* out_masks);
+
+// Two overlapping colliders, as indices in the order they were inserted, with a < b.
+typedef struct collide_pair_t {
+	int a;
+	int b;
+} collide_pair_t;
+
+// Uniform grid broadphase.
+// Colliders are inserted into every grid cell their box touches, and only colliders sharing a cell
+// are tested against each other, so finding all pairs costs roughly linear time in the collider count.
+// Cells are hashed, so the grid is unbounded. Cells divide the Y-Z plane the game's colliders spread across,
+// and candidates sharing a cell are confirmed as intersecting() would, at SIMD width in crowded cells.
+typedef struct collide_grid_t collide_grid_t;
+
+// Create a grid broadphase. cell_size should be around the size of a typical collider.
+collide_grid_t* collide_grid_create(heap_t* heap, float cell_size);
+
+// Destroy a grid broadphase.
+void collide_grid_destroy(collide_grid_t* grid);
+
+// Remove every collider, ready for the next frame's inserts.
+void collide_grid_clear(collide_grid_t* grid);
+
+// Insert a copy of a collider. Returns its index, counting from zero since the last clear.
+int collide_grid_insert(collide_grid_t* grid, const collide_t* collider);
+
+// Find every pair of inserted colliders that intersect. Each pair is reported once.
+// Returns the pairs, valid until the next call on the grid, and writes their number to out_count.
+const collide_pair_t* collide_grid_find_pairs(collide_grid_t* grid, int* out_count);
@@ -0,0 +1,27 @@
+#pragma once
+
+// Growable array helper shared by the broadphases.
+
+#include "heap.h"
+
+#include <string.h>
+
+// Grow an array so it holds at least needed elements, keeping the first count.
+// Capacity at least doubles, so repeated growth costs amortized constant time per element.
+// Returns the array, which moves if it grew.
+__forceinline void* collide_grow_array(heap_t* heap, void* array, int count, int* capacity, int needed, size_t element_size)
+{
+	if (needed <= *capacity)
+	{
+		return array;
+	}
+	int new_capacity = __max(needed, *capacity ? *capacity * 2 : 64);
+	void* new_array = heap_alloc(heap, element_size * new_capacity, 8);
+	if (array)
+	{
+		memcpy(new_array, array, element_size * count);
+		heap_free(heap, array);
+	}
+	*capacity = new_capacity;
+	return new_array;
+}
@@ -0,0 +1,352 @@
+#include "collide_sap.h"
+
+#include "collide_array.h"
+#include "heap.h"
+
+#include <stdint.h>
+#include <string.h>
+
+enum
+{
+	k_sap_axis_count = 3,
+	k_sap_empty_pair = -1,
+};
+
+// One end of a collider's box along an axis.
+typedef struct sap_endpoint_t
+{
+	float value;
+	int handle;
+	bool is_max;
+} sap_endpoint_t;
+
+typedef struct sap_proxy_t
+{
+	collide_t collider;
+	bool is_live;
+	// Removed, with ends still in the sorted lists until the next update.
+	bool is_removed;
+	// Next free handle, once the handle is free.
+	int next_free;
+} sap_proxy_t;
+
+typedef struct collide_sap_t
+{
+	heap_t* heap;
+
+	int proxy_count;
+	int proxy_capacity;
+	sap_proxy_t* proxies;
+	int first_free;
+	bool has_removed;
+
+	// Sorted by value, with minimums before maximums of equal value so touching boxes overlap.
+	int endpoint_count;
+	int endpoint_capacity;
+	sap_endpoint_t* endpoints[k_sap_axis_count];
+
+	// Overlapping pairs, open addressed by pair key. Unused slots hold k_sap_empty_pair.
+	int pair_count;
+	int pair_table_capacity;
+	int64_t* pair_table;
+
+	int event_count;
+	int event_capacity;
+	collide_sap_event_t* events;
+	bool events_returned;
+} collide_sap_t;
+
+static float axis_min(const collide_t* collider, int axis)
+{
+	return axis == 0 ? collider->minX : axis == 1 ? collider->minY : collider->minZ;
+}
+
+static float axis_max(const collide_t* collider, int axis)
+{
+	return axis == 0 ? collider->maxX : axis == 1 ? collider->maxY : collider->maxZ;
+}
+
+static int64_t pair_key(int a, int b)
+{
+	return a < b ? ((int64_t)a << 32) | (uint32_t)b : ((int64_t)b << 32) | (uint32_t)a;
+}
+
+static int pair_slot(const collide_sap_t* sap, int64_t key)
+{
+	uint64_t hash = (uint64_t)key * 0x9e3779b97f4a7c15ull;
+	return (int)(hash >> 32) & (sap->pair_table_capacity - 1);
+}
+
+// Find the slot holding key, or the empty slot where it would go.
+static int find_pair(const collide_sap_t* sap, int64_t key)
+{
+	int mask = sap->pair_table_capacity - 1;
+	int slot = pair_slot(sap, key);
+	while (sap->pair_table[slot] != key && sap->pair_table[slot] != k_sap_empty_pair)
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+static void push_event(collide_sap_t* sap, collide_sap_event_type_t type, int64_t key)
+{
+	sap->events = collide_grow_array(sap->heap, sap->events, sap->event_count, &sap->event_capacity, sap->event_count + 1, sizeof(collide_sap_event_t));
+	sap->events[sap->event_count++] = (collide_sap_event_t){ .type = type, .a = (int)(key >> 32), .b = (int)(uint32_t)key };
+}
+
+// Grow the pair table so one more pair fits with the table at most half full.
+static void reserve_pair(collide_sap_t* sap)
+{
+	if ((sap->pair_count + 1) * 2 <= sap->pair_table_capacity)
+	{
+		return;
+	}
+	int64_t* old_table = sap->pair_table;
+	int old_capacity = sap->pair_table_capacity;
+	sap->pair_table_capacity = old_capacity ? old_capacity * 2 : 64;
+	sap->pair_table = heap_alloc(sap->heap, sizeof(int64_t) * sap->pair_table_capacity, 8);
+	memset(sap->pair_table, 0xff, sizeof(int64_t) * sap->pair_table_capacity);
+	for (int i = 0; i < old_capacity; ++i)
+	{
+		if (old_table[i] != k_sap_empty_pair)
+		{
+			sap->pair_table[find_pair(sap, old_table[i])] = old_table[i];
+		}
+	}
+	if (old_table)
+	{
+		heap_free(sap->heap, old_table);
+	}
+}
+
+static void add_pair(collide_sap_t* sap, int a, int b)
+{
+	reserve_pair(sap);
+	int64_t key = pair_key(a, b);
+	int slot = find_pair(sap, key);
+	if (sap->pair_table[slot] == k_sap_empty_pair)
+	{
+		sap->pair_table[slot] = key;
+		sap->pair_count++;
+		push_event(sap, k_collide_sap_begin_overlap, key);
+	}
+}
+
+// Empty a slot, shifting back any later entries of its probe run so lookups still find them.
+static void remove_pair_slot(collide_sap_t* sap, int slot)
+{
+	int mask = sap->pair_table_capacity - 1;
+	push_event(sap, k_collide_sap_end_overlap, sap->pair_table[slot]);
+	sap->pair_table[slot] = k_sap_empty_pair;
+	sap->pair_count--;
+	for (int next = (slot + 1) & mask; sap->pair_table[next] != k_sap_empty_pair; next = (next + 1) & mask)
+	{
+		int home = pair_slot(sap, sap->pair_table[next]);
+		// Move the entry into the hole unless its home lies cyclically in (slot, next].
+		bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+		if (!stays)
+		{
+			sap->pair_table[slot] = sap->pair_table[next];
+			sap->pair_table[next] = k_sap_empty_pair;
+			slot = next;
+		}
+	}
+}
+
+static void remove_pair(collide_sap_t* sap, int a, int b)
+{
+	if (!sap->pair_count)
+	{
+		return;
+	}
+	int slot = find_pair(sap, pair_key(a, b));
+	if (sap->pair_table[slot] != k_sap_empty_pair)
+	{
+		remove_pair_slot(sap, slot);
+	}
+}
+
+// Start a fresh list of events once the last list has been handed out.
+static void begin_events(collide_sap_t* sap)
+{
+	if (sap->events_returned)
+	{
+		sap->event_count = 0;
+		sap->events_returned = false;
+	}
+}
+
+collide_sap_t* collide_sap_create(heap_t* heap)
+{
+	collide_sap_t* sap = heap_alloc(heap, sizeof(collide_sap_t), 8);
+	memset(sap, 0, sizeof(*sap));
+	sap->heap = heap;
+	sap->first_free = -1;
+	return sap;
+}
+
+void collide_sap_destroy(collide_sap_t* sap)
+{
+	void* arrays[] = { sap->proxies, sap->pair_table, sap->events };
+	for (int i = 0; i < _countof(arrays); ++i)
+	{
+		if (arrays[i])
+		{
+			heap_free(sap->heap, arrays[i]);
+		}
+	}
+	for (int axis = 0; axis < k_sap_axis_count; ++axis)
+	{
+		if (sap->endpoints[axis])
+		{
+			heap_free(sap->heap, sap->endpoints[axis]);
+		}
+	}
+	heap_free(sap->heap, sap);
+}
+
+int collide_sap_add(collide_sap_t* sap, const collide_t* collider)
+{
+	begin_events(sap);
+
+	int handle = sap->first_free;
+	if (handle >= 0)
+	{
+		sap->first_free = sap->proxies[handle].next_free;
+	}
+	else
+	{
+		handle = sap->proxy_count;
+		sap->proxies = collide_grow_array(sap->heap, sap->proxies, sap->proxy_count, &sap->proxy_capacity, handle + 1, sizeof(sap_proxy_t));
+		sap->proxy_count++;
+	}
+	sap->proxies[handle] = (sap_proxy_t){ .collider = *collider, .is_live = true, .next_free = -1 };
+
+	// Append the new ends; the next update sorts them into place.
+	int capacity = 0;
+	for (int axis = 0; axis < k_sap_axis_count; ++axis)
+	{
+		capacity = sap->endpoint_capacity;
+		sap->endpoints[axis] = collide_grow_array(sap->heap, sap->endpoints[axis], sap->endpoint_count, &capacity, sap->endpoint_count + 2, sizeof(sap_endpoint_t));
+		sap->endpoints[axis][sap->endpoint_count] = (sap_endpoint_t){ .value = axis_min(collider, axis), .handle = handle, .is_max = false };
+		sap->endpoints[axis][sap->endpoint_count + 1] = (sap_endpoint_t){ .value = axis_max(collider, axis), .handle = handle, .is_max = true };
+	}
+	sap->endpoint_capacity = capacity;
+	sap->endpoint_count += 2;
+	return handle;
+}
+
+void collide_sap_remove(collide_sap_t* sap, int handle)
+{
+	begin_events(sap);
+
+	for (int slot = 0; slot < sap->pair_table_capacity && sap->pair_count; ++slot)
+	{
+		// Shifting back after a removal can move an unvisited pair into this slot, so look again.
+		while (sap->pair_table[slot] != k_sap_empty_pair &&
+			((int)(sap->pair_table[slot] >> 32) == handle || (int)(uint32_t)sap->pair_table[slot] == handle))
+		{
+			remove_pair_slot(sap, slot);
+		}
+	}
+
+	// Endpoints are dropped at the next update, so the handle is reused only after that.
+	sap->proxies[handle].is_live = false;
+	sap->proxies[handle].is_removed = true;
+	sap->has_removed = true;
+}
+
+void collide_sap_move(collide_sap_t* sap, int handle, const collide_t* collider)
+{
+	sap->proxies[handle].collider = *collider;
+}
+
+// Insertion sort one axis. A minimum moving below a maximum may begin an overlap,
+// and a maximum moving below a minimum ends one.
+static void sort_axis(collide_sap_t* sap, sap_endpoint_t* endpoints)
+{
+	for (int i = 1; i < sap->endpoint_count; ++i)
+	{
+		sap_endpoint_t endpoint = endpoints[i];
+		int j = i - 1;
+		while (j >= 0 && (endpoint.value < endpoints[j].value || (endpoint.value == endpoints[j].value && !endpoint.is_max && endpoints[j].is_max)))
+		{
+			const sap_endpoint_t* passed = &endpoints[j];
+			if (!endpoint.is_max && passed->is_max)
+			{
+				// Overlaps on this axis now; check the others with the boxes as they are now.
+				if (intersecting(&sap->proxies[endpoint.handle].collider, &sap->proxies[passed->handle].collider))
+				{
+					add_pair(sap, endpoint.handle, passed->handle);
+				}
+			}
+			else if (endpoint.is_max && !passed->is_max)
+			{
+				remove_pair(sap, endpoint.handle, passed->handle);
+			}
+			endpoints[j + 1] = endpoints[j];
+			--j;
+		}
+		endpoints[j + 1] = endpoint;
+	}
+}
+
+const collide_sap_event_t* collide_sap_update(collide_sap_t* sap, int* out_count)
+{
+	begin_events(sap);
+
+	// Drop the ends of removed colliders, and free their handles.
+	if (sap->has_removed)
+	{
+		int count = 0;
+		for (int axis = 0; axis < k_sap_axis_count; ++axis)
+		{
+			sap_endpoint_t* endpoints = sap->endpoints[axis];
+			count = 0;
+			for (int i = 0; i < sap->endpoint_count; ++i)
+			{
+				if (sap->proxies[endpoints[i].handle].is_live)
+				{
+					endpoints[count++] = endpoints[i];
+				}
+			}
+		}
+		sap->endpoint_count = count;
+		for (int handle = 0; handle < sap->proxy_count; ++handle)
+		{
+			sap_proxy_t* proxy = &sap->proxies[handle];
+			if (proxy->is_removed)
+			{
+				proxy->is_removed = false;
+				proxy->next_free = sap->first_free;
+				sap->first_free = handle;
+			}
+		}
+		sap->has_removed = false;
+	}
+
+	for (int axis = 0; axis < k_sap_axis_count; ++axis)
+	{
+		sap_endpoint_t* endpoints = sap->endpoints[axis];
+		for (int i = 0; i < sap->endpoint_count; ++i)
+		{
+			const collide_t* collider = &sap->proxies[endpoints[i].handle].collider;
+			endpoints[i].value = endpoints[i].is_max ? axis_max(collider, axis) : axis_min(collider, axis);
+		}
+		sort_axis(sap, endpoints);
+	}
+
+	sap->events_returned = true;
+	*out_count = sap->event_count;
+	return sap->events;
+}
+
+bool collide_sap_is_overlapping(collide_sap_t* sap, int a, int b)
+{
+	if (!sap->pair_count)
+	{
+		return false;
+	}
+	return sap->pair_table[find_pair(sap, pair_key(a, b))] != k_sap_empty_pair;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Sweep and prune broadphase.
+// Keeps the ends of every collider's box sorted along each axis intersecting() tests, and re-sorts
+// them with an insertion sort each update. Colliders that move a little between frames only
+// swap with their neighbors, so an update costs close to linear time, and every swap that starts
+// or ends an overlap is reported as an event.
+
+#include "collide.h"
+
+#include <stdbool.h>
+
+// Handle to a sweep and prune broadphase.
+typedef struct collide_sap_t collide_sap_t;
+
+typedef struct heap_t heap_t;
+
+typedef enum collide_sap_event_type_t
+{
+	k_collide_sap_begin_overlap,
+	k_collide_sap_end_overlap,
+} collide_sap_event_type_t;
+
+// Two colliders that started or stopped overlapping, as handles from collide_sap_add(), with a < b.
+typedef struct collide_sap_event_t
+{
+	collide_sap_event_type_t type;
+	int a;
+	int b;
+} collide_sap_event_t;
+
+// Create a sweep and prune broadphase.
+collide_sap_t* collide_sap_create(heap_t* heap);
+
+// Destroy a sweep and prune broadphase.
+void collide_sap_destroy(collide_sap_t* sap);
+
+// Add a collider. Returns a handle for it; handles of removed colliders are reused.
+// Overlaps with it begin at the next update.
+int collide_sap_add(collide_sap_t* sap, const collide_t* collider);
+
+// Remove a collider. Its overlaps end at the next update.
+void collide_sap_remove(collide_sap_t* sap, int handle);
+
+// Set a collider's new box. Overlaps change at the next update.
+void collide_sap_move(collide_sap_t* sap, int handle, const collide_t* collider);
+
+// Re-sort the box ends and find the overlaps that began or ended since the last update.
+// Returns the events, valid until the next call on the broadphase, and writes their number to out_count.
+const collide_sap_event_t* collide_sap_update(collide_sap_t* sap, int* out_count);
+
+// Determine if two colliders overlapped as of the last update.
+bool collide_sap_is_overlapping(collide_sap_t* sap, int a, int b);
@@ -0,0 +1,481 @@
+#include "collide_tree.h"
+
+#include "collide_array.h"
+#include "heap.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+enum
+{
+	k_tree_null = -1,
+	// Depth-first traversals keep at most one pending node per level, plus one.
+	k_tree_stack_size = 128,
+};
+
+typedef struct tree_box_t
+{
+	float min[3];
+	float max[3];
+} tree_box_t;
+
+typedef struct tree_node_t
+{
+	// Fat box for leaves, and the union of the children's boxes otherwise.
+	tree_box_t box;
+	// Leaves only.
+	collide_t collider;
+	// Next free node while the node is free.
+	int parent;
+	// Both k_tree_null for leaves.
+	int child1;
+	int child2;
+	// Zero for leaves, -1 while the node is free.
+	int height;
+} tree_node_t;
+
+typedef struct collide_tree_t
+{
+	heap_t* heap;
+	float margin;
+	int root;
+
+	int node_count;
+	int node_capacity;
+	tree_node_t* nodes;
+	int first_free;
+} collide_tree_t;
+
+static tree_box_t box_from_collider(const collide_t* collider, float margin)
+{
+	return (tree_box_t)
+	{
+		.min = { collider->minX - margin, collider->minY - margin, collider->minZ - margin },
+		.max = { collider->maxX + margin, collider->maxY + margin, collider->maxZ + margin },
+	};
+}
+
+static tree_box_t box_union(const tree_box_t* a, const tree_box_t* b)
+{
+	tree_box_t result;
+	for (int i = 0; i < 3; ++i)
+	{
+		result.min[i] = fminf(a->min[i], b->min[i]);
+		result.max[i] = fmaxf(a->max[i], b->max[i]);
+	}
+	return result;
+}
+
+// Half the surface area, the cost of a box in the insertion heuristic.
+static float box_cost(const tree_box_t* box)
+{
+	float x = box->max[0] - box->min[0];
+	float y = box->max[1] - box->min[1];
+	float z = box->max[2] - box->min[2];
+	return x * y + y * z + z * x;
+}
+
+static bool box_contains(const tree_box_t* outer, const tree_box_t* inner)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (inner->min[i] < outer->min[i] || inner->max[i] > outer->max[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool box_overlaps(const tree_box_t* a, const tree_box_t* b)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (a->min[i] > b->max[i] || a->max[i] < b->min[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Clip the segment origin + t * delta, t in [0, max_fraction], against a box.
+// Writes where the segment enters the box, zero if it starts inside.
+static bool segment_hits_box(const tree_box_t* box, const float* origin, const float* delta, float max_fraction, float* out_fraction)
+{
+	float t_min = 0.0f;
+	float t_max = max_fraction;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (delta[i] == 0.0f)
+		{
+			if (origin[i] < box->min[i] || origin[i] > box->max[i])
+			{
+				return false;
+			}
+			continue;
+		}
+		float inverse = 1.0f / delta[i];
+		float t1 = (box->min[i] - origin[i]) * inverse;
+		float t2 = (box->max[i] - origin[i]) * inverse;
+		t_min = fmaxf(t_min, fminf(t1, t2));
+		t_max = fminf(t_max, fmaxf(t1, t2));
+		if (t_min > t_max)
+		{
+			return false;
+		}
+	}
+	*out_fraction = t_min;
+	return true;
+}
+
+static bool is_leaf(const tree_node_t* node)
+{
+	return node->child1 == k_tree_null;
+}
+
+static int allocate_node(collide_tree_t* tree)
+{
+	if (tree->first_free == k_tree_null)
+	{
+		int old_capacity = tree->node_capacity;
+		tree->nodes = collide_grow_array(tree->heap, tree->nodes, old_capacity, &tree->node_capacity, old_capacity + 1, sizeof(tree_node_t));
+		for (int i = old_capacity; i < tree->node_capacity; ++i)
+		{
+			tree->nodes[i].parent = i + 1 < tree->node_capacity ? i + 1 : k_tree_null;
+			tree->nodes[i].height = -1;
+		}
+		tree->first_free = old_capacity;
+	}
+
+	int index = tree->first_free;
+	tree_node_t* node = &tree->nodes[index];
+	tree->first_free = node->parent;
+	node->parent = k_tree_null;
+	node->child1 = k_tree_null;
+	node->child2 = k_tree_null;
+	node->height = 0;
+	tree->node_count++;
+	return index;
+}
+
+static void free_node(collide_tree_t* tree, int index)
+{
+	tree->nodes[index].parent = tree->first_free;
+	tree->nodes[index].height = -1;
+	tree->first_free = index;
+	tree->node_count--;
+}
+
+// Point the parent of old_child, or the root, at new_child.
+static void replace_child(collide_tree_t* tree, int parent, int old_child, int new_child)
+{
+	if (parent == k_tree_null)
+	{
+		tree->root = new_child;
+	}
+	else if (tree->nodes[parent].child1 == old_child)
+	{
+		tree->nodes[parent].child1 = new_child;
+	}
+	else
+	{
+		tree->nodes[parent].child2 = new_child;
+	}
+}
+
+// If one child of a is more than one level taller than the other, rotate the taller child up
+// into a's place, and hand a the shorter of its grandchildren.
+// Returns the index of the node now in a's place.
+static int balance(collide_tree_t* tree, int a)
+{
+	tree_node_t* nodes = tree->nodes;
+	if (is_leaf(&nodes[a]) || nodes[a].height < 2)
+	{
+		return a;
+	}
+
+	int b = nodes[a].child1;
+	int c = nodes[a].child2;
+	int difference = nodes[c].height - nodes[b].height;
+	if (difference >= -1 && difference <= 1)
+	{
+		return a;
+	}
+
+	// Rotate up the taller child, up, keeping the other child, stay, under a.
+	int up = difference > 1 ? c : b;
+	int stay = difference > 1 ? b : c;
+	int f = nodes[up].child1;
+	int g = nodes[up].child2;
+
+	nodes[up].child1 = a;
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+	replace_child(tree, nodes[up].parent, a, up);
+
+	// The taller grandchild stays with up; the shorter one moves under a in up's old place.
+	int keep = nodes[f].height > nodes[g].height ? f : g;
+	int move = keep == f ? g : f;
+	nodes[up].child2 = keep;
+	if (up == c)
+	{
+		nodes[a].child2 = move;
+	}
+	else
+	{
+		nodes[a].child1 = move;
+	}
+	nodes[move].parent = a;
+
+	nodes[a].box = box_union(&nodes[stay].box, &nodes[move].box);
+	nodes[a].height = 1 + __max(nodes[stay].height, nodes[move].height);
+	nodes[up].box = box_union(&nodes[a].box, &nodes[keep].box);
+	nodes[up].height = 1 + __max(nodes[a].height, nodes[keep].height);
+	return up;
+}
+
+// Walk from a node to the root, balancing and refitting each ancestor.
+static void refit_ancestors(collide_tree_t* tree, int index)
+{
+	while (index != k_tree_null)
+	{
+		index = balance(tree, index);
+		tree_node_t* node = &tree->nodes[index];
+		const tree_node_t* child1 = &tree->nodes[node->child1];
+		const tree_node_t* child2 = &tree->nodes[node->child2];
+		node->height = 1 + __max(child1->height, child2->height);
+		node->box = box_union(&child1->box, &child2->box);
+		index = node->parent;
+	}
+}
+
+static void insert_leaf(collide_tree_t* tree, int leaf)
+{
+	tree_node_t* nodes = tree->nodes;
+	if (tree->root == k_tree_null)
+	{
+		tree->root = leaf;
+		nodes[leaf].parent = k_tree_null;
+		return;
+	}
+
+	// Descend toward the sibling that adds the least box area to the tree.
+	const tree_box_t* leaf_box = &nodes[leaf].box;
+	int index = tree->root;
+	while (!is_leaf(&nodes[index]))
+	{
+		tree_box_t combined = box_union(&nodes[index].box, leaf_box);
+		float combined_cost = box_cost(&combined);
+		// Cost of pairing with this node, and of pushing the leaf further down, which grows this node anyway.
+		float cost = 2.0f * combined_cost;
+		float inherited_cost = 2.0f * (combined_cost - box_cost(&nodes[index].box));
+
+		float child_costs[2];
+		int children[2] = { nodes[index].child1, nodes[index].child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			const tree_node_t* child = &nodes[children[i]];
+			tree_box_t child_combined = box_union(&child->box, leaf_box);
+			child_costs[i] = box_cost(&child_combined) + inherited_cost;
+			if (!is_leaf(child))
+			{
+				child_costs[i] -= box_cost(&child->box);
+			}
+		}
+
+		if (cost < child_costs[0] && cost < child_costs[1])
+		{
+			break;
+		}
+		index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+	}
+
+	// Pair the leaf with the sibling under a new parent.
+	int sibling = index;
+	int old_parent = nodes[sibling].parent;
+	int new_parent = allocate_node(tree);
+	nodes = tree->nodes;
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].box = box_union(&nodes[leaf].box, &nodes[sibling].box);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].child1 = sibling;
+	nodes[new_parent].child2 = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+	replace_child(tree, old_parent, sibling, new_parent);
+
+	refit_ancestors(tree, old_parent);
+}
+
+static void remove_leaf(collide_tree_t* tree, int leaf)
+{
+	tree_node_t* nodes = tree->nodes;
+	if (leaf == tree->root)
+	{
+		tree->root = k_tree_null;
+		return;
+	}
+
+	// The leaf's sibling takes its parent's place.
+	int parent = nodes[leaf].parent;
+	int grandparent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+	replace_child(tree, grandparent, parent, sibling);
+	nodes[sibling].parent = grandparent;
+	free_node(tree, parent);
+
+	refit_ancestors(tree, grandparent);
+}
+
+collide_tree_t* collide_tree_create(heap_t* heap, float margin)
+{
+	collide_tree_t* tree = heap_alloc(heap, sizeof(collide_tree_t), 8);
+	memset(tree, 0, sizeof(*tree));
+	tree->heap = heap;
+	tree->margin = margin;
+	tree->root = k_tree_null;
+	tree->first_free = k_tree_null;
+	return tree;
+}
+
+void collide_tree_destroy(collide_tree_t* tree)
+{
+	if (tree->nodes)
+	{
+		heap_free(tree->heap, tree->nodes);
+	}
+	heap_free(tree->heap, tree);
+}
+
+int collide_tree_insert(collide_tree_t* tree, const collide_t* collider)
+{
+	int leaf = allocate_node(tree);
+	tree->nodes[leaf].collider = *collider;
+	tree->nodes[leaf].box = box_from_collider(collider, tree->margin);
+	insert_leaf(tree, leaf);
+	return leaf;
+}
+
+void collide_tree_remove(collide_tree_t* tree, int handle)
+{
+	remove_leaf(tree, handle);
+	free_node(tree, handle);
+}
+
+bool collide_tree_move(collide_tree_t* tree, int handle, const collide_t* collider)
+{
+	tree->nodes[handle].collider = *collider;
+	tree_box_t box = box_from_collider(collider, 0.0f);
+	if (box_contains(&tree->nodes[handle].box, &box))
+	{
+		return false;
+	}
+
+	remove_leaf(tree, handle);
+	tree->nodes[handle].box = box_from_collider(collider, tree->margin);
+	insert_leaf(tree, handle);
+	return true;
+}
+
+const collide_t* collide_tree_get_collider(collide_tree_t* tree, int handle)
+{
+	return &tree->nodes[handle].collider;
+}
+
+int collide_tree_query(collide_tree_t* tree, const collide_t* region, int* out_handles, int max_handles)
+{
+	if (tree->root == k_tree_null)
+	{
+		return 0;
+	}
+
+	tree_box_t region_box = box_from_collider(region, 0.0f);
+	int count = 0;
+	int stack[k_tree_stack_size];
+	int stack_count = 0;
+	stack[stack_count++] = tree->root;
+	while (stack_count > 0)
+	{
+		const tree_node_t* node = &tree->nodes[stack[--stack_count]];
+		if (!box_overlaps(&node->box, &region_box))
+		{
+			continue;
+		}
+		if (is_leaf(node))
+		{
+			tree_box_t box = box_from_collider(&node->collider, 0.0f);
+			if (box_overlaps(&box, &region_box))
+			{
+				if (count < max_handles)
+				{
+					out_handles[count] = (int)(node - tree->nodes);
+				}
+				count++;
+			}
+		}
+		else
+		{
+			assert(stack_count + 2 <= k_tree_stack_size);
+			stack[stack_count++] = node->child1;
+			stack[stack_count++] = node->child2;
+		}
+	}
+	return count;
+}
+
+bool collide_tree_raycast(collide_tree_t* tree, const vec3f_t* start, const vec3f_t* end, collide_tree_hit_t* out_hit)
+{
+	if (tree->root == k_tree_null)
+	{
+		return false;
+	}
+
+	float origin[3] = { start->x, start->y, start->z };
+	float delta[3] = { end->x - start->x, end->y - start->y, end->z - start->z };
+	float max_fraction = 1.0f;
+	int hit = k_tree_null;
+
+	int stack[k_tree_stack_size];
+	int stack_count = 0;
+	stack[stack_count++] = tree->root;
+	while (stack_count > 0)
+	{
+		const tree_node_t* node = &tree->nodes[stack[--stack_count]];
+		float fraction;
+		if (!segment_hits_box(&node->box, origin, delta, max_fraction, &fraction))
+		{
+			continue;
+		}
+		if (is_leaf(node))
+		{
+			// Shorten the segment to each hit, so nodes beyond it are skipped.
+			tree_box_t box = box_from_collider(&node->collider, 0.0f);
+			if (segment_hits_box(&box, origin, delta, max_fraction, &fraction))
+			{
+				max_fraction = fraction;
+				hit = (int)(node - tree->nodes);
+			}
+		}
+		else
+		{
+			assert(stack_count + 2 <= k_tree_stack_size);
+			stack[stack_count++] = node->child1;
+			stack[stack_count++] = node->child2;
+		}
+	}
+
+	if (hit == k_tree_null)
+	{
+		return false;
+	}
+	out_hit->handle = hit;
+	out_hit->fraction = max_fraction;
+	return true;
+}
+
+int collide_tree_get_height(collide_tree_t* tree)
+{
+	return tree->root == k_tree_null ? 0 : tree->nodes[tree->root].height + 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Dynamic bounding volume tree broadphase.
+// Keeps colliders in a balanced binary tree of boxes, where each box holds its children's.
+// Leaves hold fat boxes, a margin larger than their collider, so small moves do not touch the tree.
+// Ray casts and region queries skip whole subtrees and cost about O(log n), however unevenly the
+// colliders are spread, and memory grows only with the collider count.
+// Boxes cover all three axes.
+
+#include "collide.h"
+#include "vec3f.h"
+
+#include <stdbool.h>
+
+// Handle to a dynamic bounding volume tree.
+typedef struct collide_tree_t collide_tree_t;
+
+typedef struct heap_t heap_t;
+
+// The nearest collider along a ray.
+typedef struct collide_tree_hit_t
+{
+	// Handle from collide_tree_insert().
+	int handle;
+	// Distance along the ray to where it enters the collider, as a fraction of start to end.
+	float fraction;
+} collide_tree_hit_t;
+
+// Create a tree. Fat boxes extend margin beyond their collider on every side.
+collide_tree_t* collide_tree_create(heap_t* heap, float margin);
+
+// Destroy a tree.
+void collide_tree_destroy(collide_tree_t* tree);
+
+// Insert a collider. Returns a handle for it; handles of removed colliders are reused.
+int collide_tree_insert(collide_tree_t* tree, const collide_t* collider);
+
+// Remove a collider.
+void collide_tree_remove(collide_tree_t* tree, int handle);
+
+// Set a collider's new box. The tree changes only when the box leaves its fat box.
+// Returns true if the tree changed.
+bool collide_tree_move(collide_tree_t* tree, int handle, const collide_t* collider);
+
+// Get the collider last set for a handle.
+const collide_t* collide_tree_get_collider(collide_tree_t* tree, int handle);
+
+// Find colliders that overlap region on all three axes.
+// Writes up to max_handles handles to out_handles and returns the total number found.
+int collide_tree_query(collide_tree_t* tree, const collide_t* region, int* out_handles, int max_handles);
+
+// Find the nearest collider crossed by the segment from start to end.
+// Rays starting inside a collider hit it at fraction zero. Returns false if nothing is hit.
+bool collide_tree_raycast(collide_tree_t* tree, const vec3f_t* start, const vec3f_t* end, collide_tree_hit_t* out_hit);
+
+// Return the height of the tree: zero when empty, one for a single collider.
+int collide_tree_get_height(collide_tree_t* tree);
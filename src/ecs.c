@@ -1,14 +1,41 @@
 #include "ecs.h"
 
+#include "atomic.h"
 #include "debug.h"
+#include "fs.h"
 #include "heap.h"
 
 #include <string.h>
 
+#include <intrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ECS_SCAN_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ECS_SCAN_SSE2
+#endif
+
 enum
 {
-	k_max_component_types = 64,
-	k_max_entities = 512,
+	k_max_component_types = k_ecs_max_component_types,
+	k_max_registered_queries = 64,
+	k_max_cmd_buffers = 64,
+	k_max_prefabs = 64,
+	k_max_name_length = 32,
+
+	// Command buffers record into blocks of at least this size that are kept between frames.
+	k_cmd_block_size = 16 * 1024,
+	k_cmd_alignment = 16,
+
+	// Entities and components are stored in fixed-size pages.
+	// Pages are never moved or freed until the ECS is destroyed, so component pointers stay stable.
+	k_entity_page_shift = 10,
+	k_entities_per_page = 1 << k_entity_page_shift,
+	k_entity_page_mask = k_entities_per_page - 1,
+
+	// Ad-hoc queries test masks and states a block at a time to build a bitmap of matches.
+	k_scan_block_size = 64,
 };
 
 typedef enum entity_state_t
@@ -19,156 +46,2240 @@ typedef enum entity_state_t
 	k_entity_pending_remove,
 } entity_state_t;
 
+// Growable array of entity indices.
+typedef struct entity_list_t
+{
+	int* entities;
+	int count;
+	int capacity;
+} entity_list_t;
+
+_Static_assert(sizeof(entity_state_t) == sizeof(int32_t), "Entity states are scanned as 32-bit lanes.");
+_Static_assert(k_entities_per_page % k_scan_block_size == 0, "Scan blocks must not straddle pages.");
+
+// Set of entity indices with O(1) insert, remove, and membership test.
+// Members are packed densely for iteration; the sparse index is paged like entity storage.
+typedef struct entity_set_t
+{
+	entity_list_t dense;
+	int** sparse_pages;
+} entity_set_t;
+
+// Persistent query whose matching entities are maintained as they change.
+typedef struct registered_query_t
+{
+	ecs_mask_t component_mask;
+	entity_set_t entities;
+	// Changes whenever an entity joins or leaves.
+	uint32_t membership_version;
+} registered_query_t;
+
+// Template component data for spawning entities in bulk.
+typedef struct prefab_t
+{
+	ecs_mask_t component_mask;
+	void* components[k_max_component_types];
+	// Interned name given to spawned entities, or -1.
+	int name_id;
+} prefab_t;
+
+// An interned entity name and the entities that have it.
+typedef struct entity_name_t
+{
+	char string[k_max_name_length];
+	uint32_t hash;
+	entity_list_t entities;
+} entity_name_t;
+
+// An entity's interned name and its place in that name's entity list.
+typedef struct entity_name_slot_t
+{
+	// Name index + 1, zero if unnamed.
+	int name;
+	int list_index;
+} entity_name_slot_t;
+
+typedef enum cmd_type_t
+{
+	k_cmd_spawn,
+	k_cmd_remove,
+	k_cmd_write,
+} cmd_type_t;
+
+// Every command starts with this header.
+// Size includes the header and any trailing component data, rounded up to k_cmd_alignment.
+typedef struct cmd_header_t
+{
+	cmd_type_t type;
+	uint32_t size;
+} cmd_header_t;
+
+typedef struct cmd_spawn_t
+{
+	cmd_header_t header;
+	ecs_mask_t component_mask;
+	// Prefab to spawn from, or -1 to spawn from component_mask.
+	int prefab;
+	ecs_entity_ref_t* out_ref;
+	// Filled in at playback so later writes to this spawn can find the entity.
+	ecs_entity_ref_t ref;
+} cmd_spawn_t;
+
+typedef struct cmd_remove_t
+{
+	cmd_header_t header;
+	ecs_entity_ref_t ref;
+} cmd_remove_t;
+
+// Component data follows the command at the next k_cmd_alignment boundary.
+typedef struct cmd_write_t
+{
+	cmd_header_t header;
+	ecs_entity_ref_t ref;
+	cmd_spawn_t* spawn;
+	int component_type;
+} cmd_write_t;
+
+typedef struct cmd_block_t
+{
+	struct cmd_block_t* next;
+	size_t capacity;
+	size_t used;
+} cmd_block_t;
+
+typedef struct ecs_cmd_buffer_t
+{
+	ecs_t* ecs;
+	cmd_block_t* first_block;
+	cmd_block_t* current_block;
+	// Spawn commands recorded so far, indexed by the handle returned from ecs_cmd_buffer_spawn().
+	cmd_spawn_t** spawns;
+	int spawn_count;
+	int spawn_capacity;
+} ecs_cmd_buffer_t;
+
+typedef struct entity_page_t
+{
+	int sequences[k_entities_per_page];
+	entity_state_t entity_states[k_entities_per_page];
+	// Masks are stored a word at a time so queries only load the words they test.
+	uint64_t component_masks[k_ecs_mask_words][k_entities_per_page];
+} entity_page_t;
+
 typedef struct ecs_t
 {
 	heap_t* heap;
 	int global_sequence;
 
-	int sequences[k_max_entities];
-	entity_state_t entity_states[k_max_entities];
-	uint64_t component_masks[k_max_entities];
+	int max_entities;
+	int page_capacity;
+	int page_count;
+	int entity_count;
+	entity_page_t** pages;
 
-	void* components[k_max_component_types];
+	entity_list_t free_entities;
+	entity_list_t pending_add_entities;
+	entity_list_t pending_remove_entities;
+
+	registered_query_t registered_queries[k_max_registered_queries];
+	int registered_query_count;
+
+	ecs_cmd_buffer_t* cmd_buffers[k_max_cmd_buffers];
+	int cmd_buffer_count;
+
+	prefab_t prefabs[k_max_prefabs];
+	int prefab_count;
+
+	// Interned entity names. The table is open-addressed by hash and holds name index + 1; zero slots are empty.
+	entity_name_t* names;
+	int name_count;
+	int name_capacity;
+	int* name_table;
+	int name_table_capacity;
+	// Per-entity names. Allocated a page at a time once entities on it are named.
+	entity_name_slot_t** entity_name_pages;
+
+	// Write stamp for component access; see ecs_version_checkpoint().
+	uint32_t version;
+
+	// Component and version pages. Paged types are indexed by entity; sparse types by dense index.
+	char** components[k_max_component_types];
+	uint32_t** component_versions[k_max_component_types];
+	ecs_storage_t component_storage[k_max_component_types];
+	// Entities that have each sparse component, in the same order as its data.
+	entity_set_t component_sets[k_max_component_types];
+	ecs_component_fixup_t component_fixups[k_max_component_types];
+	void* component_fixup_users[k_max_component_types];
 	size_t component_type_sizes[k_max_component_types];
+	size_t component_type_alignments[k_max_component_types];
 	char component_type_names[k_max_component_types][32];
 } ecs_t;
 
-ecs_t* ecs_create(heap_t* heap)
+static void entity_list_push(heap_t* heap, entity_list_t* list, int entity)
 {
-	ecs_t* ecs = heap_alloc(heap, sizeof(ecs_t), 8);
-	memset(ecs, 0, sizeof(*ecs));
-	ecs->heap = heap;
-	ecs->global_sequence = 1;
-	return ecs;
+	if (list->count == list->capacity)
+	{
+		int new_capacity = list->capacity ? list->capacity * 2 : 64;
+		int* new_entities = heap_alloc(heap, sizeof(int) * new_capacity, 8);
+		if (list->entities)
+		{
+			memcpy(new_entities, list->entities, sizeof(int) * list->count);
+			heap_free(heap, list->entities);
+		}
+		list->entities = new_entities;
+		list->capacity = new_capacity;
+	}
+	list->entities[list->count++] = entity;
 }
 
-void ecs_destroy(ecs_t* ecs)
+// Replace the contents of a list with count entities.
+static void entity_list_assign(heap_t* heap, entity_list_t* list, const void* entities, int count)
 {
-	for (int i = 0; i < _countof(ecs->components); ++i)
+	if (count > list->capacity)
 	{
-		if (ecs->components[i])
+		int new_capacity = __max(count, 64);
+		if (list->entities)
 		{
-			heap_free(ecs->heap, ecs->components[i]);
+			heap_free(heap, list->entities);
 		}
+		list->entities = heap_alloc(heap, sizeof(int) * new_capacity, 8);
+		list->capacity = new_capacity;
 	}
-	heap_free(ecs->heap, ecs);
+	if (count > 0)
+	{
+		memcpy(list->entities, entities, sizeof(int) * count);
+	}
+	list->count = count;
 }
 
-void ecs_update(ecs_t* ecs)
+static void entity_list_destroy(heap_t* heap, entity_list_t* list)
+{
+	if (list->entities)
+	{
+		heap_free(heap, list->entities);
+	}
+	memset(list, 0, sizeof(*list));
+}
+
+static entity_page_t* get_entity_page(ecs_t* ecs, int entity)
+{
+	return ecs->pages[entity >> k_entity_page_shift];
+}
+
+static ecs_mask_t get_entity_mask(entity_page_t* page, int index)
+{
+	ecs_mask_t mask;
+	for (int w = 0; w < k_ecs_mask_words; ++w)
+	{
+		mask.words[w] = page->component_masks[w][index];
+	}
+	return mask;
+}
+
+static void set_entity_mask(entity_page_t* page, int index, ecs_mask_t mask)
+{
+	for (int w = 0; w < k_ecs_mask_words; ++w)
+	{
+		page->component_masks[w][index] = mask.words[w];
+	}
+}
+
+static int find_first_set(uint64_t bits)
+{
+	unsigned long index;
+#if defined(_M_X64)
+	_BitScanForward64(&index, bits);
+#else
+	if (!_BitScanForward(&index, (unsigned long)bits))
+	{
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		index += 32;
+	}
+#endif
+	return (int)index;
+}
+
+// Build a bitmap of the active entities in a block whose mask words contain component_mask.
+static uint64_t scan_block(const uint64_t* masks, const entity_state_t* states, uint64_t component_mask)
 {
-	for (int i = 0; i < _countof(ecs->entity_states); ++i)
+	uint64_t bits = 0;
+#if defined(ECS_SCAN_AVX2)
+	__m256i query_mask = _mm256_set1_epi64x((long long)component_mask);
+	__m256i min_state = _mm256_set1_epi32(k_entity_active - 1);
+	for (int i = 0; i < k_scan_block_size; i += 8)
+	{
+		__m256i masks_lo = _mm256_loadu_si256((const __m256i*)&masks[i]);
+		__m256i masks_hi = _mm256_loadu_si256((const __m256i*)&masks[i + 4]);
+		__m256i match_lo = _mm256_cmpeq_epi64(_mm256_and_si256(masks_lo, query_mask), query_mask);
+		__m256i match_hi = _mm256_cmpeq_epi64(_mm256_and_si256(masks_hi, query_mask), query_mask);
+		uint32_t mask_bits = _mm256_movemask_pd(_mm256_castsi256_pd(match_lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(match_hi)) << 4);
+
+		__m256i state = _mm256_loadu_si256((const __m256i*)&states[i]);
+		uint32_t state_bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(state, min_state)));
+
+		bits |= (uint64_t)(mask_bits & state_bits) << i;
+	}
+#elif defined(ECS_SCAN_SSE2)
+	__m128i query_mask = _mm_set1_epi64x((long long)component_mask);
+	__m128i min_state = _mm_set1_epi32(k_entity_active - 1);
+	for (int i = 0; i < k_scan_block_size; i += 4)
+	{
+		// SSE2 has no 64-bit compare; a 64-bit lane matches when both of its 32-bit halves do.
+		__m128i masks_lo = _mm_loadu_si128((const __m128i*)&masks[i]);
+		__m128i masks_hi = _mm_loadu_si128((const __m128i*)&masks[i + 2]);
+		__m128i match_lo = _mm_cmpeq_epi32(_mm_and_si128(masks_lo, query_mask), query_mask);
+		__m128i match_hi = _mm_cmpeq_epi32(_mm_and_si128(masks_hi, query_mask), query_mask);
+		match_lo = _mm_and_si128(match_lo, _mm_shuffle_epi32(match_lo, _MM_SHUFFLE(2, 3, 0, 1)));
+		match_hi = _mm_and_si128(match_hi, _mm_shuffle_epi32(match_hi, _MM_SHUFFLE(2, 3, 0, 1)));
+		uint32_t mask_bits = _mm_movemask_pd(_mm_castsi128_pd(match_lo)) | (_mm_movemask_pd(_mm_castsi128_pd(match_hi)) << 2);
+
+		__m128i state = _mm_loadu_si128((const __m128i*)&states[i]);
+		uint32_t state_bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(state, min_state)));
+
+		bits |= (uint64_t)(mask_bits & state_bits) << i;
+	}
+#else
+	for (int i = 0; i < k_scan_block_size; ++i)
 	{
-		if (ecs->entity_states[i] == k_entity_pending_add)
+		if ((masks[i] & component_mask) == component_mask && states[i] >= k_entity_active)
 		{
-			ecs->entity_states[i] = k_entity_active;
+			bits |= 1ULL << i;
 		}
-		else if (ecs->entity_states[i] == k_entity_pending_remove)
+	}
+#endif
+	return bits;
+}
+
+// Scan the block of entity slots starting at index.
+// Word zero is always scanned so inactive entities are excluded; other words only if the query uses them,
+// so queries over the first 64 component types cost the same as with a single-word mask.
+static uint64_t scan_entities(ecs_t* ecs, int index, const ecs_mask_t* component_mask)
+{
+	entity_page_t* page = get_entity_page(ecs, index);
+	int first = index & k_entity_page_mask;
+	uint64_t bits = scan_block(&page->component_masks[0][first], &page->entity_states[first], component_mask->words[0]);
+	for (int w = 1; w < k_ecs_mask_words && bits; ++w)
+	{
+		if (component_mask->words[w])
 		{
-			ecs->entity_states[i] = k_entity_unused;
+			bits &= scan_block(&page->component_masks[w][first], &page->entity_states[first], component_mask->words[w]);
 		}
 	}
+	return bits;
 }
 
-int ecs_register_component_type(ecs_t* ecs, const char* name, size_t size_per_component, size_t alignment)
+// Build a bitmap of the component versions in a block that are newer than since.
+static uint64_t scan_block_versions(const uint32_t* versions, uint32_t since)
 {
-	for (int i = 0; i < _countof(ecs->components); ++i)
+	uint64_t bits = 0;
+#if defined(ECS_SCAN_AVX2)
+	// No unsigned compare: flip the sign bit and compare signed.
+	__m256i sign = _mm256_set1_epi32((int)0x80000000);
+	__m256i threshold = _mm256_xor_si256(_mm256_set1_epi32((int)since), sign);
+	for (int i = 0; i < k_scan_block_size; i += 8)
 	{
-		if (ecs->components[i] == NULL)
+		__m256i version = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&versions[i]), sign);
+		bits |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(version, threshold))) << i;
+	}
+#elif defined(ECS_SCAN_SSE2)
+	__m128i sign = _mm_set1_epi32((int)0x80000000);
+	__m128i threshold = _mm_xor_si128(_mm_set1_epi32((int)since), sign);
+	for (int i = 0; i < k_scan_block_size; i += 4)
+	{
+		__m128i version = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&versions[i]), sign);
+		bits |= (uint64_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(version, threshold))) << i;
+	}
+#else
+	for (int i = 0; i < k_scan_block_size; ++i)
+	{
+		if (versions[i] > since)
 		{
-			size_t aligned_size = (size_per_component + (alignment - 1)) & ~(alignment - 1);
-			strcpy_s(ecs->component_type_names[i], sizeof(ecs->component_type_names[i]), name);
-			ecs->component_type_sizes[i] = aligned_size;
-			ecs->components[i] = heap_alloc(ecs->heap, aligned_size * k_max_entities, alignment);
-			memset(ecs->components[i], 0, aligned_size * k_max_entities);
-			return i;
+			bits |= 1ULL << i;
 		}
 	}
-	debug_print(k_print_warning, "Out of component types.");
-	return -1;
+#endif
+	return bits;
 }
 
-size_t ecs_get_component_type_size(ecs_t* ecs, int component_type)
+static void entity_set_create(ecs_t* ecs, entity_set_t* set)
 {
-	return ecs->component_type_sizes[component_type];
+	memset(&set->dense, 0, sizeof(set->dense));
+	set->sparse_pages = heap_alloc(ecs->heap, sizeof(int*) * ecs->page_capacity, 8);
+	memset(set->sparse_pages, 0, sizeof(int*) * ecs->page_capacity);
 }
 
-ecs_entity_ref_t ecs_entity_add(ecs_t* ecs, uint64_t component_mask)
+static void entity_set_destroy(ecs_t* ecs, entity_set_t* set)
 {
-	for (int i = 0; i < _countof(ecs->entity_states); ++i)
+	for (int p = 0; p < ecs->page_capacity; ++p)
 	{
-		if (ecs->entity_states[i] == k_entity_unused)
+		if (set->sparse_pages[p])
 		{
-			ecs->entity_states[i] = k_entity_pending_add;
-			ecs->sequences[i] = ecs->global_sequence++;
-			ecs->component_masks[i] = component_mask;
-			return (ecs_entity_ref_t) { .entity = i, .sequence = ecs->sequences[i] };
+			heap_free(ecs->heap, set->sparse_pages[p]);
 		}
 	}
-	debug_print(k_print_warning, "Out of entities.");
-	return (ecs_entity_ref_t) { .entity = -1, .sequence = -1 };
+	heap_free(ecs->heap, set->sparse_pages);
+	entity_list_destroy(ecs->heap, &set->dense);
 }
 
-void ecs_entity_remove(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add)
+// Returns the dense index of an entity, or -1 if it is not a member.
+static int entity_set_find(entity_set_t* set, int entity)
 {
-	if (ecs_is_entity_ref_valid(ecs, ref, allow_pending_add))
+	int* sparse = set->sparse_pages[entity >> k_entity_page_shift];
+	if (!sparse)
 	{
-		ecs->entity_states[ref.entity] = k_entity_pending_remove;
+		return -1;
 	}
-	else
+	int index = sparse[entity & k_entity_page_mask];
+	return index < set->dense.count && set->dense.entities[index] == entity ? index : -1;
+}
+
+static bool entity_set_contains(entity_set_t* set, int entity)
+{
+	return entity_set_find(set, entity) >= 0;
+}
+
+// Returns the dense index of the inserted entity.
+static int entity_set_insert(ecs_t* ecs, entity_set_t* set, int entity)
+{
+	int** sparse = &set->sparse_pages[entity >> k_entity_page_shift];
+	if (!*sparse)
 	{
-		debug_print(k_print_warning, "Attempting to remove inactive entity.");
+		*sparse = heap_alloc(ecs->heap, sizeof(int) * k_entities_per_page, 8);
+		memset(*sparse, 0, sizeof(int) * k_entities_per_page);
 	}
+	int index = set->dense.count;
+	(*sparse)[entity & k_entity_page_mask] = index;
+	entity_list_push(ecs->heap, &set->dense, entity);
+	return index;
 }
 
-bool ecs_is_entity_ref_valid(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add)
+// Removes an entity by moving the last member into its place.
+// Returns the dense index that was vacated.
+static int entity_set_remove(entity_set_t* set, int entity)
 {
-	return ref.entity >= 0 &&
-		ecs->sequences[ref.entity] == ref.sequence &&
-		ecs->entity_states[ref.entity] >= (allow_pending_add ? k_entity_pending_add : k_entity_active);
+	int index = set->sparse_pages[entity >> k_entity_page_shift][entity & k_entity_page_mask];
+	int last = set->dense.entities[--set->dense.count];
+	set->dense.entities[index] = last;
+	set->sparse_pages[last >> k_entity_page_shift][last & k_entity_page_mask] = index;
+	return index;
 }
 
-void* ecs_entity_get_component(ecs_t* ecs, ecs_entity_ref_t ref, int component_type, bool allow_pending_add)
+// FNV-1a hash of a name.
+static uint32_t hash_name(const char* name)
 {
-	if (ecs_is_entity_ref_valid(ecs, ref, allow_pending_add) && ecs->components[component_type])
+	uint32_t hash = 2166136261u;
+	for (const char* c = name; *c; ++c)
 	{
-		char* components = ecs->components[component_type];
-		return &components[ecs->component_type_sizes[component_type] * ref.entity];
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
 	}
-	return NULL;
+	return hash;
 }
 
-ecs_query_t ecs_query_create(ecs_t* ecs, uint64_t mask)
+// Returns the table slot holding a name, or the empty slot where it would go.
+static int find_name_slot(ecs_t* ecs, const char* name, uint32_t hash)
 {
-	ecs_query_t query = { .component_mask = mask, .entity = -1 };
-	ecs_query_next(ecs, &query);
-	return query;
+	int mask = ecs->name_table_capacity - 1;
+	for (int slot = hash & mask; ; slot = (slot + 1) & mask)
+	{
+		int name_id = ecs->name_table[slot] - 1;
+		if (name_id < 0 ||
+			(ecs->names[name_id].hash == hash && strcmp(ecs->names[name_id].string, name) == 0))
+		{
+			return slot;
+		}
+	}
 }
 
-bool ecs_query_is_valid(ecs_t* ecs, ecs_query_t* query)
+// Returns the interned index of a name, or -1 if it has not been interned.
+static int find_name(ecs_t* ecs, const char* name, uint32_t hash)
 {
-	return query->entity >= 0;
+	if (!ecs->name_table)
+	{
+		return -1;
+	}
+	return ecs->name_table[find_name_slot(ecs, name, hash)] - 1;
 }
 
-void ecs_query_next(ecs_t* ecs, ecs_query_t* query)
+// Grow the name array and table so one more name fits with the table at most half full.
+static void reserve_name(ecs_t* ecs)
 {
-	for (int i = query->entity + 1; i < _countof(ecs->component_masks); ++i)
+	if (ecs->name_count == ecs->name_capacity)
 	{
-		if ((ecs->component_masks[i] & query->component_mask) == query->component_mask && ecs->entity_states[i] >= k_entity_active)
+		int new_capacity = ecs->name_capacity ? ecs->name_capacity * 2 : 32;
+		entity_name_t* new_names = heap_alloc(ecs->heap, sizeof(entity_name_t) * new_capacity, 8);
+		if (ecs->names)
 		{
-			query->entity = i;
-			return;
+			memcpy(new_names, ecs->names, sizeof(entity_name_t) * ecs->name_count);
+			heap_free(ecs->heap, ecs->names);
+		}
+		ecs->names = new_names;
+		ecs->name_capacity = new_capacity;
+	}
+
+	if ((ecs->name_count + 1) * 2 > ecs->name_table_capacity)
+	{
+		if (ecs->name_table)
+		{
+			heap_free(ecs->heap, ecs->name_table);
+		}
+		ecs->name_table_capacity = ecs->name_table_capacity ? ecs->name_table_capacity * 2 : 64;
+		ecs->name_table = heap_alloc(ecs->heap, sizeof(int) * ecs->name_table_capacity, 8);
+		memset(ecs->name_table, 0, sizeof(int) * ecs->name_table_capacity);
+		for (int i = 0; i < ecs->name_count; ++i)
+		{
+			ecs->name_table[find_name_slot(ecs, ecs->names[i].string, ecs->names[i].hash)] = i + 1;
 		}
 	}
-	query->entity = -1;
 }
 
-void* ecs_query_get_component(ecs_t* ecs, ecs_query_t* query, int component_type)
+// Returns an entity's name slot, or NULL if no entity on its page has been named.
+static entity_name_slot_t* get_entity_name_slot(ecs_t* ecs, int entity)
+{
+	if (!ecs->entity_name_pages)
+	{
+		return NULL;
+	}
+	entity_name_slot_t* names = ecs->entity_name_pages[entity >> k_entity_page_shift];
+	return names ? &names[entity & k_entity_page_mask] : NULL;
+}
+
+// Returns the interned name of an entity, or -1 if it has none.
+static int get_entity_name_id(ecs_t* ecs, int entity)
 {
-	char* components = ecs->components[component_type];
-	return &components[ecs->component_type_sizes[component_type] * query->entity];
+	entity_name_slot_t* slot = get_entity_name_slot(ecs, entity);
+	return slot ? slot->name - 1 : -1;
 }
 
-ecs_entity_ref_t ecs_query_get_entity(ecs_t* ecs, ecs_query_t* query)
+// Move an entity from its current name's list to another's. A name_id of -1 leaves it unnamed.
+static void set_entity_name_id(ecs_t* ecs, int entity, int name_id)
+{
+	int old_name_id = get_entity_name_id(ecs, entity);
+	if (old_name_id == name_id)
+	{
+		return;
+	}
+
+	if (old_name_id >= 0)
+	{
+		// Swap the last entity in the list into this one's place.
+		entity_list_t* list = &ecs->names[old_name_id].entities;
+		int list_index = get_entity_name_slot(ecs, entity)->list_index;
+		int last = list->entities[--list->count];
+		list->entities[list_index] = last;
+		get_entity_name_slot(ecs, last)->list_index = list_index;
+	}
+
+	if (!ecs->entity_name_pages)
+	{
+		ecs->entity_name_pages = heap_alloc(ecs->heap, sizeof(entity_name_slot_t*) * ecs->page_capacity, 8);
+		memset(ecs->entity_name_pages, 0, sizeof(entity_name_slot_t*) * ecs->page_capacity);
+	}
+	int page_index = entity >> k_entity_page_shift;
+	if (!ecs->entity_name_pages[page_index])
+	{
+		ecs->entity_name_pages[page_index] = heap_alloc(ecs->heap, sizeof(entity_name_slot_t) * k_entities_per_page, 8);
+		memset(ecs->entity_name_pages[page_index], 0, sizeof(entity_name_slot_t) * k_entities_per_page);
+	}
+	entity_name_slot_t* slot = &ecs->entity_name_pages[page_index][entity & k_entity_page_mask];
+	slot->name = name_id + 1;
+
+	if (name_id >= 0)
+	{
+		slot->list_index = ecs->names[name_id].entities.count;
+		entity_list_push(ecs->heap, &ecs->names[name_id].entities, entity);
+	}
+}
+
+// Bring the entity's membership in registered queries in line with its current mask.
+static void update_registered_queries(ecs_t* ecs, int entity, ecs_mask_t component_mask)
+{
+	for (int i = 0; i < ecs->registered_query_count; ++i)
+	{
+		registered_query_t* query = &ecs->registered_queries[i];
+		bool matches = ecs_mask_contains(component_mask, query->component_mask);
+		bool contains = entity_set_contains(&query->entities, entity);
+		if (matches && !contains)
+		{
+			entity_set_insert(ecs, &query->entities, entity);
+			query->membership_version++;
+		}
+		else if (!matches && contains)
+		{
+			entity_set_remove(&query->entities, entity);
+			query->membership_version++;
+		}
+	}
+}
+
+// Returns where an entity's component lives in its type's pages, or -1 if it has none.
+static int get_component_index(ecs_t* ecs, int component_type, int entity)
+{
+	if (ecs->component_storage[component_type] == k_ecs_storage_sparse)
+	{
+		return entity_set_find(&ecs->component_sets[component_type], entity);
+	}
+	return entity;
+}
+
+static void* get_component_data(ecs_t* ecs, int component_type, int entity)
+{
+	int index = get_component_index(ecs, component_type, entity);
+	char* page = index >= 0 ? ecs->components[component_type][index >> k_entity_page_shift] : NULL;
+	if (!page)
+	{
+		return NULL;
+	}
+	return &page[ecs->component_type_sizes[component_type] * (index & k_entity_page_mask)];
+}
+
+static uint32_t* get_component_version(ecs_t* ecs, int component_type, int entity)
+{
+	int index = get_component_index(ecs, component_type, entity);
+	uint32_t* page = index >= 0 ? ecs->component_versions[component_type][index >> k_entity_page_shift] : NULL;
+	if (!page)
+	{
+		return NULL;
+	}
+	return &page[index & k_entity_page_mask];
+}
+
+// Get component memory for writing and stamp it as changed.
+static void* write_component_data(ecs_t* ecs, int component_type, int entity)
+{
+	uint32_t* version = get_component_version(ecs, component_type, entity);
+	if (!version)
+	{
+		return NULL;
+	}
+	*version = ecs->version;
+	return get_component_data(ecs, component_type, entity);
+}
+
+static void ensure_component_page(ecs_t* ecs, int component_type, int page_index)
+{
+	if (!ecs->components[component_type][page_index])
+	{
+		size_t page_size = ecs->component_type_sizes[component_type] * k_entities_per_page;
+		ecs->components[component_type][page_index] = heap_alloc(ecs->heap, page_size, ecs->component_type_alignments[component_type]);
+		memset(ecs->components[component_type][page_index], 0, page_size);
+
+		ecs->component_versions[component_type][page_index] = heap_alloc(ecs->heap, sizeof(uint32_t) * k_entities_per_page, 8);
+		memset(ecs->component_versions[component_type][page_index], 0, sizeof(uint32_t) * k_entities_per_page);
+	}
+}
+
+// Make storage available for components in new_mask that were not in old_mask.
+// New components count as changed.
+static void add_components(ecs_t* ecs, int entity, ecs_mask_t old_mask, ecs_mask_t new_mask)
+{
+	ecs_mask_t added_mask = ecs_mask_and_not(new_mask, old_mask);
+	for (int i = ecs_mask_next(added_mask, 0); i >= 0; i = ecs_mask_next(added_mask, i + 1))
+	{
+		if (ecs->components[i])
+		{
+			if (ecs->component_storage[i] == k_ecs_storage_sparse)
+			{
+				entity_set_t* set = &ecs->component_sets[i];
+				if (!entity_set_contains(set, entity))
+				{
+					int index = entity_set_insert(ecs, set, entity);
+					ensure_component_page(ecs, i, index >> k_entity_page_shift);
+					memset(get_component_data(ecs, i, entity), 0, ecs->component_type_sizes[i]);
+				}
+			}
+			else
+			{
+				ensure_component_page(ecs, i, entity >> k_entity_page_shift);
+			}
+			*get_component_version(ecs, i, entity) = ecs->version;
+		}
+	}
+}
+
+// Release storage for sparse components in old_mask that are not in new_mask.
+// The last member of each set is moved into the vacated slot to keep data packed.
+static void remove_components(ecs_t* ecs, int entity, ecs_mask_t old_mask, ecs_mask_t new_mask)
+{
+	ecs_mask_t removed_mask = ecs_mask_and_not(old_mask, new_mask);
+	for (int i = ecs_mask_next(removed_mask, 0); i >= 0; i = ecs_mask_next(removed_mask, i + 1))
+	{
+		if (ecs->component_storage[i] == k_ecs_storage_sparse)
+		{
+			entity_set_t* set = &ecs->component_sets[i];
+			if (!entity_set_contains(set, entity))
+			{
+				continue;
+			}
+			int index = entity_set_remove(set, entity);
+			int last = set->dense.count;
+			if (index != last)
+			{
+				size_t size = ecs->component_type_sizes[i];
+				memcpy(&ecs->components[i][index >> k_entity_page_shift][size * (index & k_entity_page_mask)],
+					&ecs->components[i][last >> k_entity_page_shift][size * (last & k_entity_page_mask)], size);
+				ecs->component_versions[i][index >> k_entity_page_shift][index & k_entity_page_mask] =
+					ecs->component_versions[i][last >> k_entity_page_shift][last & k_entity_page_mask];
+			}
+		}
+	}
+}
+
+ecs_t* ecs_create(heap_t* heap, int max_entities)
+{
+	ecs_t* ecs = heap_alloc(heap, sizeof(ecs_t), 8);
+	memset(ecs, 0, sizeof(*ecs));
+	ecs->heap = heap;
+	ecs->global_sequence = 1;
+	ecs->version = 1;
+	ecs->max_entities = max_entities;
+	ecs->page_capacity = (max_entities + k_entities_per_page - 1) >> k_entity_page_shift;
+	ecs->pages = heap_alloc(heap, sizeof(entity_page_t*) * ecs->page_capacity, 8);
+	memset(ecs->pages, 0, sizeof(entity_page_t*) * ecs->page_capacity);
+	return ecs;
+}
+
+void ecs_destroy(ecs_t* ecs)
+{
+	for (int i = 0; i < _countof(ecs->components); ++i)
+	{
+		if (ecs->components[i])
+		{
+			for (int p = 0; p < ecs->page_count; ++p)
+			{
+				if (ecs->components[i][p])
+				{
+					heap_free(ecs->heap, ecs->components[i][p]);
+					heap_free(ecs->heap, ecs->component_versions[i][p]);
+				}
+			}
+			heap_free(ecs->heap, ecs->components[i]);
+			heap_free(ecs->heap, ecs->component_versions[i]);
+			if (ecs->component_storage[i] == k_ecs_storage_sparse)
+			{
+				entity_set_destroy(ecs, &ecs->component_sets[i]);
+			}
+		}
+	}
+	for (int p = 0; p < ecs->page_count; ++p)
+	{
+		heap_free(ecs->heap, ecs->pages[p]);
+	}
+	heap_free(ecs->heap, ecs->pages);
+	for (int i = 0; i < ecs->registered_query_count; ++i)
+	{
+		entity_set_destroy(ecs, &ecs->registered_queries[i].entities);
+	}
+	for (int i = ecs->cmd_buffer_count - 1; i >= 0; --i)
+	{
+		ecs_cmd_buffer_destroy(ecs->cmd_buffers[i]);
+	}
+	for (int i = 0; i < ecs->prefab_count; ++i)
+	{
+		for (int c = 0; c < _countof(ecs->prefabs[i].components); ++c)
+		{
+			if (ecs->prefabs[i].components[c])
+			{
+				heap_free(ecs->heap, ecs->prefabs[i].components[c]);
+			}
+		}
+	}
+	for (int i = 0; i < ecs->name_count; ++i)
+	{
+		entity_list_destroy(ecs->heap, &ecs->names[i].entities);
+	}
+	if (ecs->names)
+	{
+		heap_free(ecs->heap, ecs->names);
+		heap_free(ecs->heap, ecs->name_table);
+	}
+	if (ecs->entity_name_pages)
+	{
+		for (int p = 0; p < ecs->page_capacity; ++p)
+		{
+			if (ecs->entity_name_pages[p])
+			{
+				heap_free(ecs->heap, ecs->entity_name_pages[p]);
+			}
+		}
+		heap_free(ecs->heap, ecs->entity_name_pages);
+	}
+	entity_list_destroy(ecs->heap, &ecs->free_entities);
+	entity_list_destroy(ecs->heap, &ecs->pending_add_entities);
+	entity_list_destroy(ecs->heap, &ecs->pending_remove_entities);
+	heap_free(ecs->heap, ecs);
+}
+
+static size_t cmd_align(size_t size)
 {
-	return (ecs_entity_ref_t) { .entity = query->entity, .sequence = ecs->sequences[query->entity] };
+	return (size + k_cmd_alignment - 1) & ~((size_t)k_cmd_alignment - 1);
+}
+
+static char* cmd_block_data(cmd_block_t* block)
+{
+	return (char*)block + cmd_align(sizeof(cmd_block_t));
+}
+
+static void cmd_buffer_playback(ecs_t* ecs, ecs_cmd_buffer_t* buffer)
+{
+	for (cmd_block_t* block = buffer->first_block; block; block = block->next)
+	{
+		char* data = cmd_block_data(block);
+		for (size_t offset = 0; offset < block->used; )
+		{
+			cmd_header_t* header = (cmd_header_t*)&data[offset];
+			if (header->type == k_cmd_spawn)
+			{
+				cmd_spawn_t* spawn = (cmd_spawn_t*)header;
+				if (spawn->prefab >= 0)
+				{
+					ecs_entity_add_many(ecs, spawn->prefab, 1, &spawn->ref);
+				}
+				else
+				{
+					spawn->ref = ecs_entity_add(ecs, spawn->component_mask);
+				}
+				if (spawn->out_ref)
+				{
+					*spawn->out_ref = spawn->ref;
+				}
+			}
+			else if (header->type == k_cmd_remove)
+			{
+				cmd_remove_t* remove = (cmd_remove_t*)header;
+				ecs_entity_remove(ecs, remove->ref, true);
+			}
+			else if (header->type == k_cmd_write)
+			{
+				cmd_write_t* write = (cmd_write_t*)header;
+				ecs_entity_ref_t ref = write->spawn ? write->spawn->ref : write->ref;
+				void* component = ecs_entity_get_component(ecs, ref, write->component_type, true);
+				if (component)
+				{
+					memcpy(component, (char*)write + cmd_align(sizeof(cmd_write_t)), ecs->component_type_sizes[write->component_type]);
+				}
+			}
+			offset += header->size;
+		}
+		block->used = 0;
+		if (block == buffer->current_block)
+		{
+			break;
+		}
+	}
+	buffer->current_block = buffer->first_block;
+	buffer->spawn_count = 0;
+}
+
+void ecs_update(ecs_t* ecs)
+{
+	// Play back deferred commands in buffer creation order, then in recording order,
+	// so results do not depend on which threads recorded them.
+	for (int i = 0; i < ecs->cmd_buffer_count; ++i)
+	{
+		cmd_buffer_playback(ecs, ecs->cmd_buffers[i]);
+	}
+
+	// Entities removed before they were fully spawned are skipped here and freed below.
+	for (int i = 0; i < ecs->pending_add_entities.count; ++i)
+	{
+		int entity = ecs->pending_add_entities.entities[i];
+		entity_page_t* page = get_entity_page(ecs, entity);
+		int index = entity & k_entity_page_mask;
+		if (page->entity_states[index] == k_entity_pending_add)
+		{
+			page->entity_states[index] = k_entity_active;
+			update_registered_queries(ecs, entity, get_entity_mask(page, index));
+		}
+	}
+	ecs->pending_add_entities.count = 0;
+
+	for (int i = 0; i < ecs->pending_remove_entities.count; ++i)
+	{
+		int entity = ecs->pending_remove_entities.entities[i];
+		entity_page_t* page = get_entity_page(ecs, entity);
+		int index = entity & k_entity_page_mask;
+		if (page->entity_states[index] == k_entity_pending_remove)
+		{
+			page->entity_states[index] = k_entity_unused;
+			remove_components(ecs, entity, get_entity_mask(page, index), ecs_mask_none());
+			update_registered_queries(ecs, entity, ecs_mask_none());
+			set_entity_name_id(ecs, entity, -1);
+			entity_list_push(ecs->heap, &ecs->free_entities, entity);
+		}
+	}
+	ecs->pending_remove_entities.count = 0;
+}
+
+int ecs_register_component_type(ecs_t* ecs, const char* name, size_t size_per_component, size_t alignment, ecs_storage_t storage)
+{
+	for (int i = 0; i < _countof(ecs->components); ++i)
+	{
+		if (ecs->components[i] == NULL)
+		{
+			size_t aligned_size = (size_per_component + (alignment - 1)) & ~(alignment - 1);
+			strcpy_s(ecs->component_type_names[i], sizeof(ecs->component_type_names[i]), name);
+			ecs->component_type_sizes[i] = aligned_size;
+			ecs->component_type_alignments[i] = alignment;
+			ecs->component_storage[i] = storage;
+			if (storage == k_ecs_storage_sparse)
+			{
+				entity_set_create(ecs, &ecs->component_sets[i]);
+			}
+			ecs->components[i] = heap_alloc(ecs->heap, sizeof(char*) * ecs->page_capacity, 8);
+			memset(ecs->components[i], 0, sizeof(char*) * ecs->page_capacity);
+			ecs->component_versions[i] = heap_alloc(ecs->heap, sizeof(uint32_t*) * ecs->page_capacity, 8);
+			memset(ecs->component_versions[i], 0, sizeof(uint32_t*) * ecs->page_capacity);
+			return i;
+		}
+	}
+	debug_print(k_print_warning, "Out of component types.");
+	return -1;
+}
+
+void ecs_register_component_fixup(ecs_t* ecs, int component_type, ecs_component_fixup_t fixup, void* user)
+{
+	ecs->component_fixups[component_type] = fixup;
+	ecs->component_fixup_users[component_type] = user;
+}
+
+size_t ecs_get_component_type_size(ecs_t* ecs, int component_type)
+{
+	return ecs->component_type_sizes[component_type];
+}
+
+static void ensure_entity_page(ecs_t* ecs, int page_index)
+{
+	while (page_index >= ecs->page_count)
+	{
+		ecs->pages[ecs->page_count] = heap_alloc(ecs->heap, sizeof(entity_page_t), 8);
+		memset(ecs->pages[ecs->page_count], 0, sizeof(entity_page_t));
+		ecs->page_count++;
+	}
+}
+
+static int allocate_entity_slot(ecs_t* ecs)
+{
+	if (ecs->free_entities.count > 0)
+	{
+		return ecs->free_entities.entities[--ecs->free_entities.count];
+	}
+	if (ecs->entity_count >= ecs->max_entities)
+	{
+		return -1;
+	}
+	int entity = ecs->entity_count++;
+	ensure_entity_page(ecs, entity >> k_entity_page_shift);
+	return entity;
+}
+
+ecs_entity_ref_t ecs_entity_add(ecs_t* ecs, ecs_mask_t component_mask)
+{
+	int entity = allocate_entity_slot(ecs);
+	if (entity < 0)
+	{
+		debug_print(k_print_warning, "Out of entities.");
+		return (ecs_entity_ref_t) { .entity = -1, .sequence = -1 };
+	}
+
+	add_components(ecs, entity, ecs_mask_none(), component_mask);
+
+	entity_page_t* page = get_entity_page(ecs, entity);
+	int index = entity & k_entity_page_mask;
+	page->entity_states[index] = k_entity_pending_add;
+	page->sequences[index] = ecs->global_sequence++;
+	set_entity_mask(page, index, component_mask);
+	entity_list_push(ecs->heap, &ecs->pending_add_entities, entity);
+	return (ecs_entity_ref_t) { .entity = entity, .sequence = page->sequences[index] };
+}
+
+void ecs_entity_remove(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add)
+{
+	if (ecs_is_entity_ref_valid(ecs, ref, allow_pending_add))
+	{
+		entity_state_t* state = &get_entity_page(ecs, ref.entity)->entity_states[ref.entity & k_entity_page_mask];
+		if (*state != k_entity_pending_remove)
+		{
+			*state = k_entity_pending_remove;
+			entity_list_push(ecs->heap, &ecs->pending_remove_entities, ref.entity);
+		}
+	}
+	else
+	{
+		debug_print(k_print_warning, "Attempting to remove inactive entity.");
+	}
+}
+
+void ecs_entity_set_component_mask(ecs_t* ecs, ecs_entity_ref_t ref, ecs_mask_t component_mask)
+{
+	if (!ecs_is_entity_ref_valid(ecs, ref, true))
+	{
+		debug_print(k_print_warning, "Attempting to change components of inactive entity.");
+		return;
+	}
+
+	entity_page_t* page = get_entity_page(ecs, ref.entity);
+	int index = ref.entity & k_entity_page_mask;
+	ecs_mask_t old_mask = get_entity_mask(page, index);
+	add_components(ecs, ref.entity, old_mask, component_mask);
+	remove_components(ecs, ref.entity, old_mask, component_mask);
+	set_entity_mask(page, index, component_mask);
+	if (page->entity_states[index] >= k_entity_active)
+	{
+		update_registered_queries(ecs, ref.entity, component_mask);
+	}
+}
+
+int ecs_prefab_register(ecs_t* ecs, ecs_mask_t component_mask)
+{
+	if (ecs->prefab_count >= _countof(ecs->prefabs))
+	{
+		debug_print(k_print_warning, "Out of prefabs.");
+		return -1;
+	}
+
+	prefab_t* prefab = &ecs->prefabs[ecs->prefab_count];
+	memset(prefab, 0, sizeof(*prefab));
+	prefab->component_mask = component_mask;
+	prefab->name_id = -1;
+	for (int i = ecs_mask_next(component_mask, 0); i >= 0; i = ecs_mask_next(component_mask, i + 1))
+	{
+		if (ecs->components[i])
+		{
+			prefab->components[i] = heap_alloc(ecs->heap, ecs->component_type_sizes[i], ecs->component_type_alignments[i]);
+			memset(prefab->components[i], 0, ecs->component_type_sizes[i]);
+		}
+	}
+	return ecs->prefab_count++;
+}
+
+void* ecs_prefab_get_component(ecs_t* ecs, int prefab, int component_type)
+{
+	return ecs->prefabs[prefab].components[component_type];
+}
+
+void ecs_prefab_set_name(ecs_t* ecs, int prefab, const char* name)
+{
+	ecs->prefabs[prefab].name_id = ecs_name_intern(ecs, name);
+}
+
+// Allocate up to max_count consecutive entity slots within one page.
+// Returns the number allocated; the first slot is written to first.
+static int allocate_entity_run(ecs_t* ecs, int max_count, int* first)
+{
+	int entity = allocate_entity_slot(ecs);
+	if (entity < 0)
+	{
+		return 0;
+	}
+	*first = entity;
+
+	int count = 1;
+	while (count < max_count && ((entity + count) & k_entity_page_mask) != 0)
+	{
+		int next = entity + count;
+		if (ecs->free_entities.count > 0)
+		{
+			if (ecs->free_entities.entities[ecs->free_entities.count - 1] != next)
+			{
+				break;
+			}
+			ecs->free_entities.count--;
+		}
+		else if (next == ecs->entity_count && next < ecs->max_entities)
+		{
+			ecs->entity_count++;
+		}
+		else
+		{
+			break;
+		}
+		count++;
+	}
+	return count;
+}
+
+// Copy one component into count consecutive storage slots starting at index and stamp them as changed.
+// Each page's slots are filled by copying the already filled part onto the rest, doubling each time.
+static void fill_component_run(ecs_t* ecs, int component_type, int index, int count, const void* data)
+{
+	size_t size = ecs->component_type_sizes[component_type];
+	while (count > 0)
+	{
+		int page_index = index >> k_entity_page_shift;
+		int first = index & k_entity_page_mask;
+		int page_count = __min(count, k_entities_per_page - first);
+		ensure_component_page(ecs, component_type, page_index);
+
+		char* dest = &ecs->components[component_type][page_index][size * first];
+		memcpy(dest, data, size);
+		for (int filled = 1; filled < page_count; )
+		{
+			int copy_count = __min(filled, page_count - filled);
+			memcpy(dest + size * filled, dest, size * copy_count);
+			filled += copy_count;
+		}
+
+		uint32_t* versions = &ecs->component_versions[component_type][page_index][first];
+		for (int i = 0; i < page_count; ++i)
+		{
+			versions[i] = ecs->version;
+		}
+
+		index += page_count;
+		count -= page_count;
+	}
+}
+
+int ecs_entity_add_many(ecs_t* ecs, int prefab, int count, ecs_entity_ref_t* out_refs)
+{
+	prefab_t* source = &ecs->prefabs[prefab];
+	int spawned = 0;
+	while (spawned < count)
+	{
+		int first;
+		int run_count = allocate_entity_run(ecs, count - spawned, &first);
+		if (run_count == 0)
+		{
+			debug_print(k_print_warning, "Out of entities.");
+			break;
+		}
+
+		entity_page_t* page = get_entity_page(ecs, first);
+		for (int i = 0; i < run_count; ++i)
+		{
+			int index = (first + i) & k_entity_page_mask;
+			page->entity_states[index] = k_entity_pending_add;
+			page->sequences[index] = ecs->global_sequence++;
+			set_entity_mask(page, index, source->component_mask);
+			entity_list_push(ecs->heap, &ecs->pending_add_entities, first + i);
+			if (out_refs)
+			{
+				out_refs[spawned + i] = (ecs_entity_ref_t) { .entity = first + i, .sequence = page->sequences[index] };
+			}
+		}
+
+		for (int c = 0; c < _countof(source->components); ++c)
+		{
+			if (!source->components[c])
+			{
+				continue;
+			}
+			int index = first;
+			if (ecs->component_storage[c] == k_ecs_storage_sparse)
+			{
+				// Consecutive inserts get consecutive dense indices.
+				index = entity_set_insert(ecs, &ecs->component_sets[c], first);
+				for (int i = 1; i < run_count; ++i)
+				{
+					entity_set_insert(ecs, &ecs->component_sets[c], first + i);
+				}
+			}
+			fill_component_run(ecs, c, index, run_count, source->components[c]);
+		}
+
+		if (source->name_id >= 0)
+		{
+			for (int i = 0; i < run_count; ++i)
+			{
+				set_entity_name_id(ecs, first + i, source->name_id);
+			}
+		}
+
+		spawned += run_count;
+	}
+	return spawned;
+}
+
+bool ecs_is_entity_ref_valid(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add)
+{
+	if (ref.entity < 0 || ref.entity >= ecs->entity_count)
+	{
+		return false;
+	}
+	entity_page_t* page = get_entity_page(ecs, ref.entity);
+	int index = ref.entity & k_entity_page_mask;
+	return page->sequences[index] == ref.sequence &&
+		page->entity_states[index] >= (allow_pending_add ? k_entity_pending_add : k_entity_active);
+}
+
+void* ecs_entity_get_component(ecs_t* ecs, ecs_entity_ref_t ref, int component_type, bool allow_pending_add)
+{
+	if (ecs_is_entity_ref_valid(ecs, ref, allow_pending_add) && ecs->components[component_type])
+	{
+		return write_component_data(ecs, component_type, ref.entity);
+	}
+	return NULL;
+}
+
+const void* ecs_entity_read_component(ecs_t* ecs, ecs_entity_ref_t ref, int component_type, bool allow_pending_add)
+{
+	if (ecs_is_entity_ref_valid(ecs, ref, allow_pending_add) && ecs->components[component_type])
+	{
+		return get_component_data(ecs, component_type, ref.entity);
+	}
+	return NULL;
+}
+
+uint32_t ecs_entity_get_component_version(ecs_t* ecs, ecs_entity_ref_t ref, int component_type)
+{
+	if (ecs_is_entity_ref_valid(ecs, ref, true) && ecs->components[component_type])
+	{
+		uint32_t* version = get_component_version(ecs, component_type, ref.entity);
+		return version ? *version : 0;
+	}
+	return 0;
+}
+
+uint32_t ecs_version_checkpoint(ecs_t* ecs)
+{
+	return (uint32_t)atomic_increment((int*)&ecs->version);
+}
+
+int ecs_name_intern(ecs_t* ecs, const char* name)
+{
+	if (!name || !name[0])
+	{
+		return -1;
+	}
+	char string[k_max_name_length];
+	strncpy_s(string, sizeof(string), name, _TRUNCATE);
+	uint32_t hash = hash_name(string);
+	int name_id = find_name(ecs, string, hash);
+	if (name_id < 0)
+	{
+		reserve_name(ecs);
+		name_id = ecs->name_count++;
+		entity_name_t* entry = &ecs->names[name_id];
+		memset(entry, 0, sizeof(*entry));
+		strcpy_s(entry->string, sizeof(entry->string), string);
+		entry->hash = hash;
+		ecs->name_table[find_name_slot(ecs, string, hash)] = name_id + 1;
+	}
+	return name_id;
+}
+
+const char* ecs_name_get_string(ecs_t* ecs, int name_id)
+{
+	return name_id >= 0 && name_id < ecs->name_count ? ecs->names[name_id].string : NULL;
+}
+
+void ecs_entity_set_name(ecs_t* ecs, ecs_entity_ref_t ref, const char* name)
+{
+	if (!ecs_is_entity_ref_valid(ecs, ref, true))
+	{
+		debug_print(k_print_warning, "Attempting to name inactive entity.");
+		return;
+	}
+	set_entity_name_id(ecs, ref.entity, ecs_name_intern(ecs, name));
+}
+
+const char* ecs_entity_get_name(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add)
+{
+	if (!ecs_is_entity_ref_valid(ecs, ref, allow_pending_add))
+	{
+		return NULL;
+	}
+	return ecs_name_get_string(ecs, get_entity_name_id(ecs, ref.entity));
+}
+
+int ecs_entity_find_all_by_name(ecs_t* ecs, const char* name, ecs_entity_ref_t* out_refs, int max_refs, bool allow_pending_add)
+{
+	if (!name || !name[0])
+	{
+		return 0;
+	}
+	char string[k_max_name_length];
+	strncpy_s(string, sizeof(string), name, _TRUNCATE);
+	int name_id = find_name(ecs, string, hash_name(string));
+	if (name_id < 0)
+	{
+		return 0;
+	}
+
+	// Removed entities stay on the list until ecs_update() frees them.
+	entity_state_t min_state = allow_pending_add ? k_entity_pending_add : k_entity_active;
+	entity_list_t* list = &ecs->names[name_id].entities;
+	int count = 0;
+	for (int i = 0; i < list->count; ++i)
+	{
+		int entity = list->entities[i];
+		entity_page_t* page = get_entity_page(ecs, entity);
+		int index = entity & k_entity_page_mask;
+		if (page->entity_states[index] < min_state || page->entity_states[index] == k_entity_pending_remove)
+		{
+			continue;
+		}
+		if (count < max_refs)
+		{
+			out_refs[count] = (ecs_entity_ref_t) { .entity = entity, .sequence = page->sequences[index] };
+		}
+		count++;
+	}
+	return count;
+}
+
+ecs_entity_ref_t ecs_entity_find_by_name(ecs_t* ecs, const char* name, bool allow_pending_add)
+{
+	ecs_entity_ref_t ref = { .entity = -1, .sequence = -1 };
+	ecs_entity_find_all_by_name(ecs, name, &ref, 1, allow_pending_add);
+	return ref;
+}
+
+// Pick the sparse component type in mask with the fewest members, or -1 if there are none.
+// Iterating its members visits fewer entities than scanning every slot.
+static int find_sparse_type(ecs_t* ecs, ecs_mask_t mask)
+{
+	int best = -1;
+	for (int i = ecs_mask_next(mask, 0); i >= 0; i = ecs_mask_next(mask, i + 1))
+	{
+		if (ecs->component_storage[i] == k_ecs_storage_sparse &&
+			(best < 0 || ecs->component_sets[i].dense.count < ecs->component_sets[best].dense.count))
+		{
+			best = i;
+		}
+	}
+	return best;
+}
+
+ecs_query_t ecs_query_create(ecs_t* ecs, ecs_mask_t mask)
+{
+	int sparse_type = find_sparse_type(ecs, mask);
+	ecs_query_t query =
+	{
+		.component_mask = mask,
+		.entity = -1,
+		.registered_query = -1,
+		.sparse_type = sparse_type,
+		.index = sparse_type >= 0 ? -1 : 0,
+		.match_bits = 0,
+		.changed_type = -1,
+	};
+	ecs_query_next(ecs, &query);
+	return query;
+}
+
+ecs_query_t ecs_query_create_changed(ecs_t* ecs, ecs_mask_t mask, int component_type, uint32_t since_version)
+{
+	ecs_mask_add(&mask, component_type);
+	int sparse_type = find_sparse_type(ecs, mask);
+	ecs_query_t query =
+	{
+		.component_mask = mask,
+		.entity = -1,
+		.registered_query = -1,
+		.sparse_type = sparse_type,
+		.index = sparse_type >= 0 ? -1 : 0,
+		.match_bits = 0,
+		.changed_type = component_type,
+		.changed_since = since_version,
+	};
+	ecs_query_next(ecs, &query);
+	return query;
+}
+
+// Add entities that already exist to a registered query.
+static void seed_registered_query(ecs_t* ecs, registered_query_t* registered)
+{
+	for (ecs_query_t query = ecs_query_create(ecs, registered->component_mask); ecs_query_is_valid(ecs, &query); ecs_query_next(ecs, &query))
+	{
+		entity_set_insert(ecs, &registered->entities, query.entity);
+	}
+}
+
+int ecs_query_register(ecs_t* ecs, ecs_mask_t mask)
+{
+	for (int i = 0; i < ecs->registered_query_count; ++i)
+	{
+		if (ecs_mask_equal(ecs->registered_queries[i].component_mask, mask))
+		{
+			return i;
+		}
+	}
+	if (ecs->registered_query_count >= _countof(ecs->registered_queries))
+	{
+		debug_print(k_print_warning, "Out of registered queries.");
+		return -1;
+	}
+
+	int handle = ecs->registered_query_count++;
+	registered_query_t* registered = &ecs->registered_queries[handle];
+	registered->component_mask = mask;
+	entity_set_create(ecs, &registered->entities);
+	seed_registered_query(ecs, registered);
+	return handle;
+}
+
+uint32_t ecs_query_get_registered_version(ecs_t* ecs, int registered_query)
+{
+	return ecs->registered_queries[registered_query].membership_version;
+}
+
+ecs_query_t ecs_query_create_registered(ecs_t* ecs, int registered_query)
+{
+	ecs_query_t query =
+	{
+		.component_mask = ecs->registered_queries[registered_query].component_mask,
+		.entity = -1,
+		.registered_query = registered_query,
+		.sparse_type = -1,
+		.index = -1,
+		.match_bits = 0,
+		.changed_type = -1,
+	};
+	ecs_query_next(ecs, &query);
+	return query;
+}
+
+ecs_query_t ecs_query_create_registered_changed(ecs_t* ecs, int registered_query, int component_type, uint32_t since_version)
+{
+	ecs_query_t query =
+	{
+		.component_mask = ecs->registered_queries[registered_query].component_mask,
+		.entity = -1,
+		.registered_query = registered_query,
+		.sparse_type = -1,
+		.index = -1,
+		.match_bits = 0,
+		.changed_type = component_type,
+		.changed_since = since_version,
+	};
+	ecs_query_next(ecs, &query);
+	return query;
+}
+
+bool ecs_query_is_valid(ecs_t* ecs, ecs_query_t* query)
+{
+	return query->entity >= 0;
+}
+
+static bool is_query_changed(ecs_t* ecs, ecs_query_t* query, int entity)
+{
+	if (query->changed_type < 0)
+	{
+		return true;
+	}
+	uint32_t* version = get_component_version(ecs, query->changed_type, entity);
+	return version && *version > query->changed_since;
+}
+
+void ecs_query_next(ecs_t* ecs, ecs_query_t* query)
+{
+	if (query->registered_query >= 0)
+	{
+		entity_list_t* entities = &ecs->registered_queries[query->registered_query].entities.dense;
+		while (++query->index < entities->count)
+		{
+			query->entity = entities->entities[query->index];
+			if (is_query_changed(ecs, query, query->entity))
+			{
+				return;
+			}
+		}
+		query->entity = -1;
+		return;
+	}
+
+	if (query->sparse_type >= 0)
+	{
+		entity_list_t* entities = &ecs->component_sets[query->sparse_type].dense;
+		while (++query->index < entities->count)
+		{
+			int entity = entities->entities[query->index];
+			entity_page_t* page = get_entity_page(ecs, entity);
+			int index = entity & k_entity_page_mask;
+			if (page->entity_states[index] >= k_entity_active &&
+				ecs_mask_contains(get_entity_mask(page, index), query->component_mask) &&
+				is_query_changed(ecs, query, entity))
+			{
+				query->entity = entity;
+				return;
+			}
+		}
+		query->entity = -1;
+		return;
+	}
+
+	// The index is the start of the next block to scan.
+	// Slots past the high-water mark are unused, so whole blocks can always be scanned.
+	while (!query->match_bits)
+	{
+		if (query->index >= ecs->entity_count)
+		{
+			query->entity = -1;
+			return;
+		}
+		query->match_bits = scan_entities(ecs, query->index, &query->component_mask);
+		if (query->match_bits && query->changed_type >= 0)
+		{
+			uint32_t* versions = ecs->component_versions[query->changed_type][query->index >> k_entity_page_shift];
+			int first = query->index & k_entity_page_mask;
+			query->match_bits = versions ? query->match_bits & scan_block_versions(&versions[first], query->changed_since) : 0;
+		}
+		query->index += k_scan_block_size;
+	}
+
+	query->entity = query->index - k_scan_block_size + find_first_set(query->match_bits);
+	query->match_bits &= query->match_bits - 1;
+}
+
+void* ecs_query_get_component(ecs_t* ecs, ecs_query_t* query, int component_type)
+{
+	return write_component_data(ecs, component_type, query->entity);
+}
+
+const void* ecs_query_read_component(ecs_t* ecs, ecs_query_t* query, int component_type)
+{
+	return get_component_data(ecs, component_type, query->entity);
+}
+
+ecs_entity_ref_t ecs_query_get_entity(ecs_t* ecs, ecs_query_t* query)
+{
+	return (ecs_entity_ref_t) { .entity = query->entity, .sequence = get_entity_page(ecs, query->entity)->sequences[query->entity & k_entity_page_mask] };
+}
+
+ecs_chunk_query_t ecs_chunk_query_create(ecs_t* ecs, ecs_mask_t mask)
+{
+	ecs_chunk_query_t query = { .component_mask = mask, .entity = -1, .count = 0, .index = 0, .match_bits = 0 };
+	ecs_chunk_query_next(ecs, &query);
+	return query;
+}
+
+bool ecs_chunk_query_is_valid(ecs_t* ecs, ecs_chunk_query_t* query)
+{
+	return query->entity >= 0;
+}
+
+void ecs_chunk_query_next(ecs_t* ecs, ecs_chunk_query_t* query)
+{
+	// As with ecs_query_next(), index is the start of the next block to scan and
+	// match_bits holds the unvisited matches of the block before it.
+	query->count = 0;
+	while (!query->match_bits)
+	{
+		if (query->index >= ecs->entity_count)
+		{
+			query->entity = -1;
+			return;
+		}
+		query->match_bits = scan_entities(ecs, query->index, &query->component_mask);
+		query->index += k_scan_block_size;
+	}
+
+	int bit = find_first_set(query->match_bits);
+	query->entity = query->index - k_scan_block_size + bit;
+	while (true)
+	{
+		// Count the run of set bits starting at bit.
+		uint64_t run_bits = query->match_bits >> bit;
+		int run = run_bits == ~0ULL ? k_scan_block_size : find_first_set(~run_bits);
+		query->count += run;
+		if (bit + run < k_scan_block_size)
+		{
+			query->match_bits &= ~(((1ULL << run) - 1) << bit);
+			return;
+		}
+
+		// The run reaches the end of the block; continue it into the next block of the same page.
+		query->match_bits = 0;
+		if ((query->index & k_entity_page_mask) == 0 || query->index >= ecs->entity_count)
+		{
+			return;
+		}
+		query->match_bits = scan_entities(ecs, query->index, &query->component_mask);
+		query->index += k_scan_block_size;
+		if (!(query->match_bits & 1))
+		{
+			return;
+		}
+		bit = 0;
+	}
+}
+
+void* ecs_chunk_query_get_column(ecs_t* ecs, ecs_chunk_query_t* query, int component_type)
+{
+	if (ecs->component_storage[component_type] == k_ecs_storage_sparse)
+	{
+		return NULL;
+	}
+	uint32_t* versions = get_component_version(ecs, component_type, query->entity);
+	for (int i = 0; i < query->count; ++i)
+	{
+		versions[i] = ecs->version;
+	}
+	return get_component_data(ecs, component_type, query->entity);
+}
+
+const void* ecs_chunk_query_read_column(ecs_t* ecs, ecs_chunk_query_t* query, int component_type)
+{
+	if (ecs->component_storage[component_type] == k_ecs_storage_sparse)
+	{
+		return NULL;
+	}
+	return get_component_data(ecs, component_type, query->entity);
+}
+
+ecs_entity_ref_t ecs_chunk_query_get_entity(ecs_t* ecs, ecs_chunk_query_t* query, int index)
+{
+	int entity = query->entity + index;
+	return (ecs_entity_ref_t) { .entity = entity, .sequence = get_entity_page(ecs, entity)->sequences[entity & k_entity_page_mask] };
+}
+
+ecs_cmd_buffer_t* ecs_cmd_buffer_create(ecs_t* ecs)
+{
+	if (ecs->cmd_buffer_count >= _countof(ecs->cmd_buffers))
+	{
+		debug_print(k_print_warning, "Out of command buffers.");
+		return NULL;
+	}
+	ecs_cmd_buffer_t* buffer = heap_alloc(ecs->heap, sizeof(ecs_cmd_buffer_t), 8);
+	memset(buffer, 0, sizeof(*buffer));
+	buffer->ecs = ecs;
+	ecs->cmd_buffers[ecs->cmd_buffer_count++] = buffer;
+	return buffer;
+}
+
+void ecs_cmd_buffer_destroy(ecs_cmd_buffer_t* buffer)
+{
+	ecs_t* ecs = buffer->ecs;
+	for (int i = 0; i < ecs->cmd_buffer_count; ++i)
+	{
+		if (ecs->cmd_buffers[i] == buffer)
+		{
+			// Keep creation order for deterministic playback.
+			memmove(&ecs->cmd_buffers[i], &ecs->cmd_buffers[i + 1], sizeof(ecs_cmd_buffer_t*) * (ecs->cmd_buffer_count - i - 1));
+			ecs->cmd_buffer_count--;
+			break;
+		}
+	}
+
+	cmd_block_t* block = buffer->first_block;
+	while (block)
+	{
+		cmd_block_t* next = block->next;
+		heap_free(ecs->heap, block);
+		block = next;
+	}
+	if (buffer->spawns)
+	{
+		heap_free(ecs->heap, buffer->spawns);
+	}
+	heap_free(ecs->heap, buffer);
+}
+
+// Reserve space for a command in the buffer's current block, moving to the next block if needed.
+// Blocks are never moved, so commands can point at each other.
+static cmd_header_t* cmd_buffer_alloc(ecs_cmd_buffer_t* buffer, cmd_type_t type, size_t size)
+{
+	size = cmd_align(size);
+
+	cmd_block_t* block = buffer->current_block;
+	while (block && block->used + size > block->capacity)
+	{
+		block = block->next;
+		if (block)
+		{
+			block->used = 0;
+		}
+	}
+	if (!block)
+	{
+		size_t capacity = __max(size, k_cmd_block_size);
+		block = heap_alloc(buffer->ecs->heap, cmd_align(sizeof(cmd_block_t)) + capacity, k_cmd_alignment);
+		block->next = NULL;
+		block->capacity = capacity;
+		block->used = 0;
+		if (buffer->current_block)
+		{
+			// Any blocks skipped because they were too small are dropped from the chain.
+			cmd_block_t* skipped = buffer->current_block->next;
+			while (skipped)
+			{
+				cmd_block_t* next = skipped->next;
+				heap_free(buffer->ecs->heap, skipped);
+				skipped = next;
+			}
+			buffer->current_block->next = block;
+		}
+		else
+		{
+			buffer->first_block = block;
+		}
+	}
+	buffer->current_block = block;
+
+	cmd_header_t* header = (cmd_header_t*)(cmd_block_data(block) + block->used);
+	header->type = type;
+	header->size = (uint32_t)size;
+	block->used += size;
+	return header;
+}
+
+int ecs_cmd_buffer_spawn(ecs_cmd_buffer_t* buffer, ecs_mask_t component_mask, ecs_entity_ref_t* out_ref)
+{
+	cmd_spawn_t* spawn = (cmd_spawn_t*)cmd_buffer_alloc(buffer, k_cmd_spawn, sizeof(cmd_spawn_t));
+	spawn->component_mask = component_mask;
+	spawn->prefab = -1;
+	spawn->out_ref = out_ref;
+	spawn->ref = (ecs_entity_ref_t) { .entity = -1, .sequence = -1 };
+
+	if (buffer->spawn_count == buffer->spawn_capacity)
+	{
+		int new_capacity = buffer->spawn_capacity ? buffer->spawn_capacity * 2 : 64;
+		cmd_spawn_t** new_spawns = heap_alloc(buffer->ecs->heap, sizeof(cmd_spawn_t*) * new_capacity, 8);
+		if (buffer->spawns)
+		{
+			memcpy(new_spawns, buffer->spawns, sizeof(cmd_spawn_t*) * buffer->spawn_count);
+			heap_free(buffer->ecs->heap, buffer->spawns);
+		}
+		buffer->spawns = new_spawns;
+		buffer->spawn_capacity = new_capacity;
+	}
+	buffer->spawns[buffer->spawn_count] = spawn;
+	return buffer->spawn_count++;
+}
+
+int ecs_cmd_buffer_spawn_prefab(ecs_cmd_buffer_t* buffer, int prefab, ecs_entity_ref_t* out_ref)
+{
+	int spawn = ecs_cmd_buffer_spawn(buffer, buffer->ecs->prefabs[prefab].component_mask, out_ref);
+	buffer->spawns[spawn]->prefab = prefab;
+	return spawn;
+}
+
+static void* cmd_buffer_write(ecs_cmd_buffer_t* buffer, ecs_entity_ref_t ref, cmd_spawn_t* spawn, int component_type)
+{
+	size_t data_offset = cmd_align(sizeof(cmd_write_t));
+	size_t component_size = buffer->ecs->component_type_sizes[component_type];
+	cmd_write_t* write = (cmd_write_t*)cmd_buffer_alloc(buffer, k_cmd_write, data_offset + component_size);
+	write->ref = ref;
+	write->spawn = spawn;
+	write->component_type = component_type;
+	return (char*)write + data_offset;
+}
+
+void* ecs_cmd_buffer_spawn_component(ecs_cmd_buffer_t* buffer, int spawn, int component_type)
+{
+	ecs_entity_ref_t ref = { .entity = -1, .sequence = -1 };
+	return cmd_buffer_write(buffer, ref, buffer->spawns[spawn], component_type);
+}
+
+void ecs_cmd_buffer_remove(ecs_cmd_buffer_t* buffer, ecs_entity_ref_t ref)
+{
+	cmd_remove_t* remove = (cmd_remove_t*)cmd_buffer_alloc(buffer, k_cmd_remove, sizeof(cmd_remove_t));
+	remove->ref = ref;
+}
+
+void* ecs_cmd_buffer_write_component(ecs_cmd_buffer_t* buffer, ecs_entity_ref_t ref, int component_type)
+{
+	return cmd_buffer_write(buffer, ref, NULL, component_type);
+}
+
+enum
+{
+	k_snapshot_magic = 0x53534345, // 'ECSS'
+	k_snapshot_format = 3,
+};
+
+// Snapshot layout:
+//   header, then one type record per registered component type
+//   per entity page: sequences, states, then each mask word for the slots in use
+//   free, pending add and pending remove entity lists
+//   per paged component type and entity page: present flag, then the page's component data if present
+//   per sparse component type: member count, member entities, then their component data
+//   name count and name strings, then if there are names, per entity page: present flag, then the page's name indices if present
+typedef struct snapshot_header_t
+{
+	uint32_t magic;
+	uint32_t format;
+	int32_t entity_count;
+	int32_t global_sequence;
+	int32_t component_type_count;
+	int32_t free_count;
+	int32_t pending_add_count;
+	int32_t pending_remove_count;
+} snapshot_header_t;
+
+typedef struct snapshot_type_t
+{
+	char name[32];
+	uint64_t size;
+	uint32_t storage;
+	uint32_t reserved;
+} snapshot_type_t;
+
+// Sequential access to snapshot bytes.
+// Writing to a stream with no data only measures the size.
+typedef struct snapshot_stream_t
+{
+	char* data;
+	size_t size;
+	size_t offset;
+} snapshot_stream_t;
+
+static void* stream_write(snapshot_stream_t* stream, const void* source, size_t size)
+{
+	void* dest = stream->data ? stream->data + stream->offset : NULL;
+	if (dest && size)
+	{
+		memcpy(dest, source, size);
+	}
+	stream->offset += size;
+	return dest;
+}
+
+// Returns NULL if the stream ends before size bytes.
+static const void* stream_read(snapshot_stream_t* stream, size_t size)
+{
+	if (size > stream->size - stream->offset)
+	{
+		return NULL;
+	}
+	const void* source = stream->data + stream->offset;
+	stream->offset += size;
+	return source;
+}
+
+// Component types are registered into consecutive slots starting at zero.
+static int get_component_type_count(ecs_t* ecs)
+{
+	int count = 0;
+	while (count < _countof(ecs->components) && ecs->components[count])
+	{
+		count++;
+	}
+	return count;
+}
+
+// Number of slots below entity_count on a page.
+static int get_page_slot_count(int entity_count, int page_index)
+{
+	return __min(k_entities_per_page, entity_count - (page_index << k_entity_page_shift));
+}
+
+// Write count components of a type starting at a page-aligned storage index.
+static void save_component_column(ecs_t* ecs, snapshot_stream_t* stream, int component_type, int index, int count)
+{
+	size_t size = ecs->component_type_sizes[component_type];
+	void* dest = stream_write(stream, ecs->components[component_type][index >> k_entity_page_shift], size * count);
+	if (dest && ecs->component_fixups[component_type])
+	{
+		ecs->component_fixups[component_type](ecs->component_fixup_users[component_type], dest, count, false);
+	}
+}
+
+static void snapshot_save(ecs_t* ecs, snapshot_stream_t* stream)
+{
+	int type_count = get_component_type_count(ecs);
+	snapshot_header_t header =
+	{
+		.magic = k_snapshot_magic,
+		.format = k_snapshot_format,
+		.entity_count = ecs->entity_count,
+		.global_sequence = ecs->global_sequence,
+		.component_type_count = type_count,
+		.free_count = ecs->free_entities.count,
+		.pending_add_count = ecs->pending_add_entities.count,
+		.pending_remove_count = ecs->pending_remove_entities.count,
+	};
+	stream_write(stream, &header, sizeof(header));
+
+	for (int i = 0; i < type_count; ++i)
+	{
+		snapshot_type_t type = { .size = ecs->component_type_sizes[i], .storage = ecs->component_storage[i] };
+		strcpy_s(type.name, sizeof(type.name), ecs->component_type_names[i]);
+		stream_write(stream, &type, sizeof(type));
+	}
+
+	int page_count = (ecs->entity_count + k_entities_per_page - 1) >> k_entity_page_shift;
+	for (int p = 0; p < page_count; ++p)
+	{
+		int slot_count = get_page_slot_count(ecs->entity_count, p);
+		stream_write(stream, ecs->pages[p]->sequences, sizeof(int) * slot_count);
+		stream_write(stream, ecs->pages[p]->entity_states, sizeof(entity_state_t) * slot_count);
+		for (int w = 0; w < k_ecs_mask_words; ++w)
+		{
+			stream_write(stream, ecs->pages[p]->component_masks[w], sizeof(uint64_t) * slot_count);
+		}
+	}
+
+	stream_write(stream, ecs->free_entities.entities, sizeof(int) * ecs->free_entities.count);
+	stream_write(stream, ecs->pending_add_entities.entities, sizeof(int) * ecs->pending_add_entities.count);
+	stream_write(stream, ecs->pending_remove_entities.entities, sizeof(int) * ecs->pending_remove_entities.count);
+
+	for (int i = 0; i < type_count; ++i)
+	{
+		if (ecs->component_storage[i] == k_ecs_storage_sparse)
+		{
+			entity_list_t* members = &ecs->component_sets[i].dense;
+			stream_write(stream, &members->count, sizeof(int));
+			stream_write(stream, members->entities, sizeof(int) * members->count);
+			for (int index = 0; index < members->count; index += k_entities_per_page)
+			{
+				save_component_column(ecs, stream, i, index, __min(k_entities_per_page, members->count - index));
+			}
+		}
+		else
+		{
+			for (int p = 0; p < page_count; ++p)
+			{
+				uint32_t present = ecs->components[i][p] != NULL;
+				stream_write(stream, &present, sizeof(present));
+				if (present)
+				{
+					save_component_column(ecs, stream, i, p << k_entity_page_shift, get_page_slot_count(ecs->entity_count, p));
+				}
+			}
+		}
+	}
+
+	stream_write(stream, &ecs->name_count, sizeof(int));
+	for (int i = 0; i < ecs->name_count; ++i)
+	{
+		stream_write(stream, ecs->names[i].string, sizeof(ecs->names[i].string));
+	}
+	if (ecs->name_count > 0)
+	{
+		for (int p = 0; p < page_count; ++p)
+		{
+			const entity_name_slot_t* names = ecs->entity_name_pages ? ecs->entity_name_pages[p] : NULL;
+			uint32_t present = names != NULL;
+			stream_write(stream, &present, sizeof(present));
+			for (int i = 0; present && i < get_page_slot_count(ecs->entity_count, p); ++i)
+			{
+				stream_write(stream, &names[i].name, sizeof(int));
+			}
+		}
+	}
+}
+
+// Copy count components of a type to a page-aligned storage index, stamp them as changed, and fix them up.
+static void load_component_column(ecs_t* ecs, int component_type, int index, int count, const void* source)
+{
+	int page_index = index >> k_entity_page_shift;
+	ensure_component_page(ecs, component_type, page_index);
+	memcpy(ecs->components[component_type][page_index], source, ecs->component_type_sizes[component_type] * count);
+	for (int i = 0; i < count; ++i)
+	{
+		ecs->component_versions[component_type][page_index][i] = ecs->version;
+	}
+	if (ecs->component_fixups[component_type])
+	{
+		ecs->component_fixups[component_type](ecs->component_fixup_users[component_type], ecs->components[component_type][page_index], count, true);
+	}
+}
+
+static bool are_entities_valid(const int* entities, int count, int entity_count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (entities[i] < 0 || entities[i] >= entity_count)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Restore the world from a snapshot.
+// With apply false, nothing is changed; the snapshot is only checked against this ECS.
+static bool snapshot_load(ecs_t* ecs, snapshot_stream_t* stream, bool apply)
+{
+	snapshot_header_t header;
+	const void* header_data = stream_read(stream, sizeof(header));
+	if (!header_data)
+	{
+		return false;
+	}
+	memcpy(&header, header_data, sizeof(header));
+	int type_count = get_component_type_count(ecs);
+	if (header.magic != k_snapshot_magic || header.format != k_snapshot_format ||
+		header.entity_count < 0 || header.entity_count > ecs->max_entities ||
+		header.free_count < 0 || header.pending_add_count < 0 || header.pending_remove_count < 0 ||
+		header.component_type_count != type_count)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < type_count; ++i)
+	{
+		snapshot_type_t type;
+		const void* type_data = stream_read(stream, sizeof(type));
+		if (!type_data)
+		{
+			return false;
+		}
+		memcpy(&type, type_data, sizeof(type));
+		if (type.size != ecs->component_type_sizes[i] || type.storage != (uint32_t)ecs->component_storage[i] ||
+			strncmp(type.name, ecs->component_type_names[i], sizeof(type.name)) != 0)
+		{
+			debug_print(k_print_warning, "Snapshot component type %s does not match.", ecs->component_type_names[i]);
+			return false;
+		}
+	}
+
+	int page_count = (header.entity_count + k_entities_per_page - 1) >> k_entity_page_shift;
+	for (int p = 0; p < page_count; ++p)
+	{
+		int slot_count = get_page_slot_count(header.entity_count, p);
+		const void* sequences = stream_read(stream, sizeof(int) * slot_count);
+		const void* states = stream_read(stream, sizeof(entity_state_t) * slot_count);
+		const void* masks[k_ecs_mask_words];
+		bool masks_valid = true;
+		for (int w = 0; w < k_ecs_mask_words; ++w)
+		{
+			masks[w] = stream_read(stream, sizeof(uint64_t) * slot_count);
+			masks_valid &= masks[w] != NULL;
+		}
+		if (!sequences || !states || !masks_valid)
+		{
+			return false;
+		}
+		if (apply)
+		{
+			ensure_entity_page(ecs, p);
+			entity_page_t* page = ecs->pages[p];
+			memset(page, 0, sizeof(*page));
+			memcpy(page->sequences, sequences, sizeof(int) * slot_count);
+			memcpy(page->entity_states, states, sizeof(entity_state_t) * slot_count);
+			for (int w = 0; w < k_ecs_mask_words; ++w)
+			{
+				memcpy(page->component_masks[w], masks[w], sizeof(uint64_t) * slot_count);
+			}
+		}
+	}
+
+	const int* free_entities = stream_read(stream, sizeof(int) * header.free_count);
+	const int* pending_add_entities = stream_read(stream, sizeof(int) * header.pending_add_count);
+	const int* pending_remove_entities = stream_read(stream, sizeof(int) * header.pending_remove_count);
+	if ((header.free_count && !free_entities) ||
+		(header.pending_add_count && !pending_add_entities) ||
+		(header.pending_remove_count && !pending_remove_entities) ||
+		!are_entities_valid(free_entities, header.free_count, header.entity_count) ||
+		!are_entities_valid(pending_add_entities, header.pending_add_count, header.entity_count) ||
+		!are_entities_valid(pending_remove_entities, header.pending_remove_count, header.entity_count))
+	{
+		return false;
+	}
+	if (apply)
+	{
+		// Slots past the restored high-water mark must read as unused.
+		for (int p = page_count; p < ecs->page_count; ++p)
+		{
+			memset(ecs->pages[p], 0, sizeof(entity_page_t));
+		}
+		ecs->entity_count = header.entity_count;
+		ecs->global_sequence = header.global_sequence;
+		entity_list_assign(ecs->heap, &ecs->free_entities, free_entities, header.free_count);
+		entity_list_assign(ecs->heap, &ecs->pending_add_entities, pending_add_entities, header.pending_add_count);
+		entity_list_assign(ecs->heap, &ecs->pending_remove_entities, pending_remove_entities, header.pending_remove_count);
+	}
+
+	for (int i = 0; i < type_count; ++i)
+	{
+		size_t size = ecs->component_type_sizes[i];
+		if (ecs->component_storage[i] == k_ecs_storage_sparse)
+		{
+			int member_count;
+			const void* count_data = stream_read(stream, sizeof(member_count));
+			if (!count_data)
+			{
+				return false;
+			}
+			memcpy(&member_count, count_data, sizeof(member_count));
+			const int* members = member_count >= 0 && member_count <= header.entity_count ? stream_read(stream, sizeof(int) * member_count) : NULL;
+			if ((member_count && !members) || member_count < 0 || !are_entities_valid(members, member_count, header.entity_count))
+			{
+				return false;
+			}
+			if (apply)
+			{
+				entity_set_t* set = &ecs->component_sets[i];
+				entity_set_destroy(ecs, set);
+				entity_set_create(ecs, set);
+				for (int m = 0; m < member_count; ++m)
+				{
+					entity_set_insert(ecs, set, members[m]);
+				}
+			}
+			for (int index = 0; index < member_count; index += k_entities_per_page)
+			{
+				int count = __min(k_entities_per_page, member_count - index);
+				const void* data = stream_read(stream, size * count);
+				if (!data)
+				{
+					return false;
+				}
+				if (apply)
+				{
+					load_component_column(ecs, i, index, count, data);
+				}
+			}
+		}
+		else
+		{
+			for (int p = 0; p < page_count; ++p)
+			{
+				uint32_t present;
+				const void* present_data = stream_read(stream, sizeof(present));
+				if (!present_data)
+				{
+					return false;
+				}
+				memcpy(&present, present_data, sizeof(present));
+				if (!present)
+				{
+					continue;
+				}
+				int count = get_page_slot_count(header.entity_count, p);
+				const void* data = stream_read(stream, size * count);
+				if (!data)
+				{
+					return false;
+				}
+				if (apply)
+				{
+					load_component_column(ecs, i, p << k_entity_page_shift, count, data);
+				}
+			}
+		}
+	}
+
+	int name_count;
+	const void* name_count_data = stream_read(stream, sizeof(name_count));
+	if (!name_count_data)
+	{
+		return false;
+	}
+	memcpy(&name_count, name_count_data, sizeof(name_count));
+	const char* name_strings = name_count >= 0 ? stream_read(stream, (size_t)k_max_name_length * name_count) : NULL;
+	if (name_count < 0 || (name_count && !name_strings))
+	{
+		return false;
+	}
+	for (int i = 0; i < name_count; ++i)
+	{
+		if (!memchr(name_strings + k_max_name_length * i, 0, k_max_name_length))
+		{
+			return false;
+		}
+	}
+	int* name_ids = NULL;
+	if (apply)
+	{
+		// Names already interned keep their indices; saved indices are remapped onto them.
+		for (int i = 0; i < ecs->name_count; ++i)
+		{
+			ecs->names[i].entities.count = 0;
+		}
+		for (int p = 0; ecs->entity_name_pages && p < ecs->page_capacity; ++p)
+		{
+			if (ecs->entity_name_pages[p])
+			{
+				memset(ecs->entity_name_pages[p], 0, sizeof(entity_name_slot_t) * k_entities_per_page);
+			}
+		}
+		if (name_count > 0)
+		{
+			name_ids = heap_alloc(ecs->heap, sizeof(int) * name_count, 8);
+			for (int i = 0; i < name_count; ++i)
+			{
+				name_ids[i] = ecs_name_intern(ecs, name_strings + k_max_name_length * i);
+			}
+		}
+	}
+	bool names_valid = true;
+	for (int p = 0; names_valid && name_count > 0 && p < page_count; ++p)
+	{
+		uint32_t present;
+		const void* present_data = stream_read(stream, sizeof(present));
+		if (!present_data)
+		{
+			names_valid = false;
+			break;
+		}
+		memcpy(&present, present_data, sizeof(present));
+		if (!present)
+		{
+			continue;
+		}
+		int slot_count = get_page_slot_count(header.entity_count, p);
+		const int* names = stream_read(stream, sizeof(int) * slot_count);
+		names_valid = names != NULL;
+		for (int i = 0; names_valid && i < slot_count; ++i)
+		{
+			// Stored as name index + 1, zero if unnamed.
+			names_valid = names[i] >= 0 && names[i] <= name_count;
+			if (apply && names_valid && names[i] > 0 && ecs->pages[p]->entity_states[i] != k_entity_unused)
+			{
+				set_entity_name_id(ecs, (p << k_entity_page_shift) + i, name_ids[names[i] - 1]);
+			}
+		}
+	}
+	if (name_ids)
+	{
+		heap_free(ecs->heap, name_ids);
+	}
+	if (!names_valid)
+	{
+		return false;
+	}
+
+	if (apply)
+	{
+		for (int i = 0; i < ecs->registered_query_count; ++i)
+		{
+			registered_query_t* registered = &ecs->registered_queries[i];
+			entity_set_destroy(ecs, &registered->entities);
+			entity_set_create(ecs, &registered->entities);
+			seed_registered_query(ecs, registered);
+			registered->membership_version++;
+		}
+	}
+	return true;
+}
+
+bool ecs_snapshot_write(ecs_t* ecs, fs_t* fs, const char* path, bool use_compression)
+{
+	// Measure, then fill.
+	snapshot_stream_t stream = { 0 };
+	snapshot_save(ecs, &stream);
+	stream.size = stream.offset;
+	stream.data = heap_alloc(ecs->heap, stream.size, 8);
+	stream.offset = 0;
+	snapshot_save(ecs, &stream);
+
+	fs_work_t* work = fs_write(fs, path, stream.data, stream.size, use_compression);
+	int result = fs_work_get_result(work);
+	fs_work_destroy(work);
+	heap_free(ecs->heap, stream.data);
+	if (result != 0)
+	{
+		debug_print(k_print_warning, "Failed to write snapshot %s.", path);
+		return false;
+	}
+	return true;
+}
+
+bool ecs_snapshot_read(ecs_t* ecs, fs_t* fs, const char* path, bool use_compression)
+{
+	fs_work_t* work = fs_read(fs, path, ecs->heap, false, use_compression);
+	int result = fs_work_get_result(work);
+	snapshot_stream_t stream = { .data = fs_work_get_buffer(work), .size = fs_work_get_size(work) };
+
+	bool loaded = result == 0 && stream.data && snapshot_load(ecs, &stream, false);
+	if (loaded)
+	{
+		stream.offset = 0;
+		snapshot_load(ecs, &stream, true);
+	}
+	else
+	{
+		debug_print(k_print_warning, "Failed to read snapshot %s.", path);
+	}
+
+	if (stream.data)
+	{
+		heap_free(ecs->heap, stream.data);
+	}
+	fs_work_destroy(work);
+	return loaded;
 }
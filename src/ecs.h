@@ -3,61 +3,204 @@
 // Entity Component System
 // Framework for game entities and their components.
 
+#include "ecs_mask.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef struct fs_t fs_t;
 typedef struct heap_t heap_t;
 
 // Handle to an entity component system interface.
 typedef struct ecs_t ecs_t;
 
+// Handle to a buffer of deferred entity commands.
+typedef struct ecs_cmd_buffer_t ecs_cmd_buffer_t;
+
 // Weak reference to an entity.
+// The sequence is unique per spawn, so references to a destroyed entity stay invalid
+// after its slot is reused.
 typedef struct ecs_entity_ref_t
 {
 	int entity;
 	int sequence;
 } ecs_entity_ref_t;
 
+// How components of a type are stored.
+typedef enum ecs_storage_t
+{
+	// A slot for every entity, allocated a page at a time.
+	// Fastest access; best for components most entities have.
+	k_ecs_storage_paged,
+	// Packed array of only the entities that have the component, plus a sparse index.
+	// Memory is proportional to use; best for rare or frequently added and removed components.
+	k_ecs_storage_sparse,
+} ecs_storage_t;
+
+// Converts pointer-bearing components to and from a form that can be saved in a snapshot.
+// Called with an array of count components copied into a snapshot (is_load false) and with an
+// array just restored from one (is_load true). Arrays may include slots of entities without the component.
+typedef void (*ecs_component_fixup_t)(void* user, void* components, int count, bool is_load);
+
 // Working data for an active entity query.
 typedef struct ecs_query_t
 {
-	uint64_t component_mask;
+	ecs_mask_t component_mask;
 	int entity;
+	int registered_query;
+	int sparse_type;
+	int index;
+	uint64_t match_bits;
+	int changed_type;
+	uint32_t changed_since;
 } ecs_query_t;
 
+// Working data for iterating a query a chunk at a time.
+// A chunk is a run of consecutive matching entities whose paged components are contiguous in memory.
+typedef struct ecs_chunk_query_t
+{
+	ecs_mask_t component_mask;
+	int entity;
+	int count;
+	int index;
+	uint64_t match_bits;
+} ecs_chunk_query_t;
+
 // Create an entity component system.
-ecs_t* ecs_create(heap_t* heap);
+// Up to max_entities can exist at once. Storage grows in fixed-size pages as entities are spawned,
+// so only memory for the high-water mark of live entities is used.
+ecs_t* ecs_create(heap_t* heap, int max_entities);
 
 // Destroy an entity component system.
 void ecs_destroy(ecs_t* ecs);
 
 // Per-frame entity component system update.
+// Plays back all command buffers, then promotes pending adds to active and frees pending removes.
+// Cost is proportional to the number of entities added and removed since the last update.
 void ecs_update(ecs_t* ecs);
 
 // Register a type of component with the entity system.
-int ecs_register_component_type(ecs_t* ecs, const char* name, size_t size_per_component, size_t alignment);
+// Storage selects how memory for the component is laid out; see ecs_storage_t.
+// Up to k_ecs_max_component_types can be registered; returns -1 if out of types.
+int ecs_register_component_type(ecs_t* ecs, const char* name, size_t size_per_component, size_t alignment, ecs_storage_t storage);
+
+// Register a callback to fix up a component type's data when writing and reading snapshots.
+void ecs_register_component_fixup(ecs_t* ecs, int component_type, ecs_component_fixup_t fixup, void* user);
 
 // Return the size of a type of component registered with the sytem.
 size_t ecs_get_component_type_size(ecs_t* ecs, int component_type);
 
 // Spawn an entity with the masked components and return a reference to it.
-ecs_entity_ref_t ecs_entity_add(ecs_t* ecs, uint64_t component_mask);
+ecs_entity_ref_t ecs_entity_add(ecs_t* ecs, ecs_mask_t component_mask);
 
 // Destroy an entity.
 // If allow_pending_add is true, can destroy an entity that is not fully spawned.
 void ecs_entity_remove(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add);
 
+// Change the set of components on an entity.
+// Memory for newly added components is not cleared.
+// Do not call while iterating a registered query that the change affects.
+void ecs_entity_set_component_mask(ecs_t* ecs, ecs_entity_ref_t ref, ecs_mask_t component_mask);
+
+// Register a prefab: a template of initial component data for the masked components.
+// Template data starts zeroed; fill it with ecs_prefab_get_component().
+// Returns a prefab handle, or -1 if out of prefabs.
+int ecs_prefab_register(ecs_t* ecs, ecs_mask_t component_mask);
+
+// Get the template memory for a component of a prefab for writing.
+// Changes affect entities spawned from the prefab afterwards.
+// NULL is returned if the component_type is not in the prefab's mask.
+void* ecs_prefab_get_component(ecs_t* ecs, int prefab, int component_type);
+
+// Set the name given to entities spawned from a prefab afterwards.
+// NULL or an empty string spawns them unnamed.
+void ecs_prefab_set_name(ecs_t* ecs, int prefab, const char* name);
+
+// Spawn count entities from a prefab.
+// Entities are allocated in runs of consecutive slots and their components filled with bulk copies
+// of the template, so spawning many at once is much cheaper than one at a time.
+// If out_refs is not NULL, it receives a reference to each new entity.
+// Returns the number of entities spawned, which is less than count if out of entities.
+int ecs_entity_add_many(ecs_t* ecs, int prefab, int count, ecs_entity_ref_t* out_refs);
+
 // Determines if a entity reference points to a valid entity.
 // If allow_pending_add is true, entities that are not fully spawned are considered valid.
 bool ecs_is_entity_ref_valid(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add);
 
-// Get the memory for a component on an entity.
+// Get the memory for a component on an entity for writing.
+// The component's version is stamped as changed.
+// Paged component memory does not move for the lifetime of the entity component system.
+// Sparse component memory may move when the same component is removed from another entity.
 // NULL is returned if the entity is not valid or the component_type is not present on the entity.
 // If allow_pending_add is true, will return component data for not fully spawned entities.
 void* ecs_entity_get_component(ecs_t* ecs, ecs_entity_ref_t ref, int component_type, bool allow_pending_add);
 
+// Get the memory for a component on an entity for reading.
+// Same as ecs_entity_get_component() but does not mark the component as changed.
+const void* ecs_entity_read_component(ecs_t* ecs, ecs_entity_ref_t ref, int component_type, bool allow_pending_add);
+
+// Get the version at which a component on an entity was last written.
+// Returns zero if the entity is not valid.
+uint32_t ecs_entity_get_component_version(ecs_t* ecs, ecs_entity_ref_t ref, int component_type);
+
+// Returns the current version and advances it.
+// Writes made after the call have a newer version than the returned value, so a system that
+// saves the result can later find everything written since with a changed query.
+// Safe to call while other threads write components.
+uint32_t ecs_version_checkpoint(ecs_t* ecs);
+
+// Intern a name, returning an index that stays valid for the lifetime of the entity component system.
+// Names longer than 31 characters are truncated. Returns -1 for NULL or an empty string.
+int ecs_name_intern(ecs_t* ecs, const char* name);
+
+// Get the string for an interned name index, or NULL if the index is not valid.
+const char* ecs_name_get_string(ecs_t* ecs, int name_id);
+
+// Set the name of an entity, replacing any previous name.
+// NULL or an empty string clears it. Names are kept in an index and dropped when the entity is destroyed.
+// Entities that are not fully spawned can be named.
+void ecs_entity_set_name(ecs_t* ecs, ecs_entity_ref_t ref, const char* name);
+
+// Get the name of an entity, or NULL if it has none or is not valid.
+// If allow_pending_add is true, will return names of not fully spawned entities.
+const char* ecs_entity_get_name(ecs_t* ecs, ecs_entity_ref_t ref, bool allow_pending_add);
+
+// Find entities by name without scanning: cost is proportional to the number of entities with the name.
+// Writes up to max_refs references to out_refs and returns the total number found.
+// Entities pending removal are skipped. If allow_pending_add is true, not fully spawned entities are included.
+int ecs_entity_find_all_by_name(ecs_t* ecs, const char* name, ecs_entity_ref_t* out_refs, int max_refs, bool allow_pending_add);
+
+// Find an entity by name. If several have the name, any one of them is returned.
+// Returns an invalid reference if none are found.
+ecs_entity_ref_t ecs_entity_find_by_name(ecs_t* ecs, const char* name, bool allow_pending_add);
+
 // Creates a new entity query by component type mask.
-ecs_query_t ecs_query_create(ecs_t* ecs, uint64_t mask);
+// Entity masks are tested in SIMD blocks, one 64-bit word at a time, skipping words the query does not use.
+// Prefer a registered query for masks iterated every frame.
+// If the mask includes a sparse component type, only entities with that component are visited.
+ecs_query_t ecs_query_create(ecs_t* ecs, ecs_mask_t mask);
+
+// Creates a new entity query by component type mask that only visits entities whose
+// component_type was written after since_version.
+ecs_query_t ecs_query_create_changed(ecs_t* ecs, ecs_mask_t mask, int component_type, uint32_t since_version);
+
+// Register a persistent query by component type mask and return a handle to it.
+// The set of matching entities is kept up to date as entities are added, removed, and change components,
+// so iterating a registered query does no mask testing.
+// Registering the same mask twice returns the same handle.
+int ecs_query_register(ecs_t* ecs, ecs_mask_t mask);
+
+// Returns a number that changes whenever an entity joins or leaves a registered query.
+// Lets systems that cache per-entity data detect when the set of entities is different.
+uint32_t ecs_query_get_registered_version(ecs_t* ecs, int registered_query);
+
+// Creates a new entity query over the entities matched by a registered query.
+// Iteration order is not sorted by entity.
+ecs_query_t ecs_query_create_registered(ecs_t* ecs, int registered_query);
+
+// Creates a new entity query over a registered query that only visits entities whose
+// component_type was written after since_version.
+ecs_query_t ecs_query_create_registered_changed(ecs_t* ecs, int registered_query, int component_type, uint32_t since_version);
 
 // Determines if the query points at a valid entity.
 bool ecs_query_is_valid(ecs_t* ecs, ecs_query_t* query);
@@ -65,8 +208,75 @@ bool ecs_query_is_valid(ecs_t* ecs, ecs_query_t* query);
 // Advances the query to the next matching entity, if any.
 void ecs_query_next(ecs_t* ecs, ecs_query_t* query);
 
-// Get data for a component on the entity referenced by the query, if any.
+// Get data for a component on the entity referenced by the query for writing.
+// The component's version is stamped as changed.
 void* ecs_query_get_component(ecs_t* ecs, ecs_query_t* query, int component_type);
 
+// Get data for a component on the entity referenced by the query for reading.
+const void* ecs_query_read_component(ecs_t* ecs, ecs_query_t* query, int component_type);
+
 // Get a entity reference for the current query location.
 ecs_entity_ref_t ecs_query_get_entity(ecs_t* ecs, ecs_query_t* query);
+
+// Creates a new chunked query by component type mask.
+// Each chunk covers count matching entities starting at entity, all within one storage page.
+ecs_chunk_query_t ecs_chunk_query_create(ecs_t* ecs, ecs_mask_t mask);
+
+// Determines if the chunked query points at a valid chunk.
+bool ecs_chunk_query_is_valid(ecs_t* ecs, ecs_chunk_query_t* query);
+
+// Advances the chunked query to the next run of matching entities, if any.
+void ecs_chunk_query_next(ecs_t* ecs, ecs_chunk_query_t* query);
+
+// Get the array of a component for every entity in the current chunk for writing.
+// All of the chunk's components of this type are stamped as changed.
+// The component_type must be in the query mask. Returns NULL for sparse component types,
+// which are not stored by entity; use ecs_entity_get_component() for those.
+void* ecs_chunk_query_get_column(ecs_t* ecs, ecs_chunk_query_t* query, int component_type);
+
+// Get the array of a component for every entity in the current chunk for reading.
+const void* ecs_chunk_query_read_column(ecs_t* ecs, ecs_chunk_query_t* query, int component_type);
+
+// Get a entity reference for an entity in the current chunk.
+ecs_entity_ref_t ecs_chunk_query_get_entity(ecs_t* ecs, ecs_chunk_query_t* query, int index);
+
+// Create a buffer for recording entity commands to be played back later.
+// Recording touches only the buffer, so each thread can record into its own buffer without locking.
+// All buffers are played back during ecs_update(), in the order the buffers were created.
+ecs_cmd_buffer_t* ecs_cmd_buffer_create(ecs_t* ecs);
+
+// Destroy a command buffer. Unplayed commands are discarded.
+void ecs_cmd_buffer_destroy(ecs_cmd_buffer_t* buffer);
+
+// Record spawning an entity with the masked components.
+// Returns a spawn handle, valid until playback, for ecs_cmd_buffer_spawn_component().
+// If out_ref is not NULL, the new entity's reference is written to it at playback.
+int ecs_cmd_buffer_spawn(ecs_cmd_buffer_t* buffer, ecs_mask_t component_mask, ecs_entity_ref_t* out_ref);
+
+// Record spawning an entity from a prefab.
+// Same as ecs_cmd_buffer_spawn() but components start as a copy of the prefab's template.
+int ecs_cmd_buffer_spawn_prefab(ecs_cmd_buffer_t* buffer, int prefab, ecs_entity_ref_t* out_ref);
+
+// Record initial data for a component on an entity spawned by this buffer.
+// Returns memory in the buffer for the caller to fill; it is copied to the entity at playback.
+void* ecs_cmd_buffer_spawn_component(ecs_cmd_buffer_t* buffer, int spawn, int component_type);
+
+// Record destroying an entity.
+void ecs_cmd_buffer_remove(ecs_cmd_buffer_t* buffer, ecs_entity_ref_t ref);
+
+// Record writing a whole component on an existing entity.
+// Returns memory in the buffer for the caller to fill; it is copied to the entity at playback.
+// The write is dropped if the entity is no longer valid at playback.
+void* ecs_cmd_buffer_write_component(ecs_cmd_buffer_t* buffer, ecs_entity_ref_t ref, int component_type);
+
+// Save entities and their components to a file.
+// Entity states, sequences, masks and component storage are written as raw blocks.
+// Registered queries and unplayed command buffers are not saved.
+// Blocks until the file is written. Returns true on success.
+bool ecs_snapshot_write(ecs_t* ecs, fs_t* fs, const char* path, bool use_compression);
+
+// Replace all entities and their components with those saved in a file.
+// Component types must be registered in the same order, with the same sizes and storage, as when saved.
+// Registered queries are rebuilt and restored components count as changed.
+// The world is left untouched if the file does not match. Returns true on success.
+bool ecs_snapshot_read(ecs_t* ecs, fs_t* fs, const char* path, bool use_compression);
@@ -0,0 +1,379 @@
+#include "ecs_bench.h"
+
+#include "debug.h"
+#include "ecs.h"
+#include "fs.h"
+#include "heap.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+enum
+{
+	k_bench_repeat = 8,
+	k_bench_spawn_repeat = 3,
+	// Percent of entities removed and respawned per frame in the churn update benchmark.
+	k_bench_churn_percent = 1,
+};
+
+typedef struct bench_component_t
+{
+	float value[4];
+} bench_component_t;
+
+// CSV text of the results so far.
+typedef struct bench_results_t
+{
+	heap_t* heap;
+	char* text;
+	size_t size;
+	size_t capacity;
+} bench_results_t;
+
+// An ECS with an "all" component on every entity and a "some" component, stored as selected,
+// on roughly density_percent of them. Queries match entities with both.
+typedef struct bench_world_t
+{
+	ecs_t* ecs;
+	int all_type;
+	int some_type;
+	ecs_mask_t all_mask;
+	ecs_mask_t query_mask;
+	ecs_entity_ref_t* refs;
+	int count;
+} bench_world_t;
+
+static const int k_entity_counts[] = { 1000, 10000, 100000, 1000000 };
+static const int k_densities[] = { 1, 10, 50, 100 };
+static const ecs_storage_t k_storages[] = { k_ecs_storage_paged, k_ecs_storage_sparse };
+
+// Keeps benchmark reads from being optimized away.
+static volatile float s_bench_sink;
+
+static double ticks_to_ns(uint64_t ticks)
+{
+	return (double)ticks * 1000000000.0 / (double)timer_get_ticks_per_second();
+}
+
+static const char* storage_name(ecs_storage_t storage)
+{
+	return storage == k_ecs_storage_sparse ? "sparse" : "paged";
+}
+
+static void results_append(bench_results_t* results, const char* text, size_t size)
+{
+	if (results->size + size + 1 > results->capacity)
+	{
+		size_t new_capacity = __max(results->capacity * 2, results->size + size + 1);
+		char* new_text = heap_alloc(results->heap, new_capacity, 8);
+		if (results->text)
+		{
+			memcpy(new_text, results->text, results->size);
+			heap_free(results->heap, results->text);
+		}
+		results->text = new_text;
+		results->capacity = new_capacity;
+	}
+	memcpy(results->text + results->size, text, size);
+	results->size += size;
+	results->text[results->size] = '\0';
+}
+
+static void results_add(bench_results_t* results, const char* suite, const char* variant, ecs_storage_t storage, int entities, int density_percent, int ops, uint64_t ticks)
+{
+	double ns = ticks_to_ns(ticks);
+	char row[256];
+	int length = sprintf_s(row, sizeof(row), "%s,%s,%s,%d,%d,%d,%.0f,%.3f\n",
+		suite, variant, storage_name(storage), entities, density_percent, ops, ns, ops ? ns / ops : 0.0);
+	if (length > 0)
+	{
+		results_append(results, row, length);
+		debug_print(k_print_info, "ecs_bench %s", row);
+	}
+}
+
+// Removed entities free their slots only in ecs_update(), so benchmarks that add entities before
+// updating need spare_count slots beyond entity_count.
+static void bench_world_create(bench_world_t* world, heap_t* heap, int entity_count, int spare_count, ecs_storage_t storage)
+{
+	world->ecs = ecs_create(heap, entity_count + spare_count);
+	world->all_type = ecs_register_component_type(world->ecs, "all", sizeof(bench_component_t), _Alignof(bench_component_t), k_ecs_storage_paged);
+	world->some_type = ecs_register_component_type(world->ecs, "some", sizeof(bench_component_t), _Alignof(bench_component_t), storage);
+	world->all_mask = ecs_mask_bit(world->all_type);
+	world->query_mask = world->all_mask;
+	ecs_mask_add(&world->query_mask, world->some_type);
+	world->refs = heap_alloc(heap, sizeof(ecs_entity_ref_t) * entity_count, 8);
+	world->count = entity_count;
+}
+
+static void bench_world_destroy(bench_world_t* world, heap_t* heap)
+{
+	heap_free(heap, world->refs);
+	ecs_destroy(world->ecs);
+}
+
+// Spawn every entity. Matches are scattered with a simple LCG so the bitmap is not trivially periodic.
+static void bench_world_populate(bench_world_t* world, int density_percent)
+{
+	uint32_t seed = 12345;
+	for (int i = 0; i < world->count; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		bool matches = (seed >> 8) % 100 < (uint32_t)density_percent;
+		world->refs[i] = ecs_entity_add(world->ecs, matches ? world->query_mask : world->all_mask);
+	}
+	ecs_update(world->ecs);
+}
+
+static void bench_spawn_despawn(bench_results_t* results, heap_t* heap)
+{
+	for (int c = 0; c < _countof(k_entity_counts); ++c)
+	{
+		for (int s = 0; s < _countof(k_storages); ++s)
+		{
+			int count = k_entity_counts[c];
+			uint64_t best_spawn = UINT64_MAX;
+			uint64_t best_despawn = UINT64_MAX;
+			uint64_t best_prefab = UINT64_MAX;
+			for (int r = 0; r < k_bench_spawn_repeat; ++r)
+			{
+				bench_world_t world;
+				bench_world_create(&world, heap, count, 0, k_storages[s]);
+
+				uint64_t start = timer_get_ticks();
+				for (int i = 0; i < count; ++i)
+				{
+					world.refs[i] = ecs_entity_add(world.ecs, world.query_mask);
+				}
+				ecs_update(world.ecs);
+				best_spawn = __min(best_spawn, timer_get_ticks() - start);
+
+				start = timer_get_ticks();
+				for (int i = 0; i < count; ++i)
+				{
+					ecs_entity_remove(world.ecs, world.refs[i], false);
+				}
+				ecs_update(world.ecs);
+				best_despawn = __min(best_despawn, timer_get_ticks() - start);
+
+				bench_world_destroy(&world, heap);
+
+				bench_world_create(&world, heap, count, 0, k_storages[s]);
+				int prefab = ecs_prefab_register(world.ecs, world.query_mask);
+				start = timer_get_ticks();
+				ecs_entity_add_many(world.ecs, prefab, count, world.refs);
+				ecs_update(world.ecs);
+				best_prefab = __min(best_prefab, timer_get_ticks() - start);
+				bench_world_destroy(&world, heap);
+			}
+			results_add(results, "spawn_despawn", "spawn", k_storages[s], count, 100, count, best_spawn);
+			results_add(results, "spawn_despawn", "spawn_prefab", k_storages[s], count, 100, count, best_prefab);
+			results_add(results, "spawn_despawn", "despawn", k_storages[s], count, 100, count, best_despawn);
+		}
+	}
+}
+
+// Iterate matches and read the "some" component of each.
+// Variant 0 is an ad-hoc query, 1 a registered query, 2 a chunked query.
+static uint64_t time_query(bench_world_t* world, int variant, int registered_query, int* match_count)
+{
+	uint64_t best = UINT64_MAX;
+	for (int r = 0; r < k_bench_repeat; ++r)
+	{
+		int count = 0;
+		float sum = 0.0f;
+		uint64_t start = timer_get_ticks();
+		if (variant == 2)
+		{
+			for (ecs_chunk_query_t chunk = ecs_chunk_query_create(world->ecs, world->query_mask);
+				ecs_chunk_query_is_valid(world->ecs, &chunk);
+				ecs_chunk_query_next(world->ecs, &chunk))
+			{
+				const bench_component_t* components = ecs_chunk_query_read_column(world->ecs, &chunk, world->some_type);
+				for (int i = 0; i < chunk.count; ++i)
+				{
+					sum += components[i].value[0];
+				}
+				count += chunk.count;
+			}
+		}
+		else
+		{
+			ecs_query_t query = variant == 1 ? ecs_query_create_registered(world->ecs, registered_query) : ecs_query_create(world->ecs, world->query_mask);
+			for (; ecs_query_is_valid(world->ecs, &query); ecs_query_next(world->ecs, &query))
+			{
+				const bench_component_t* component = ecs_query_read_component(world->ecs, &query, world->some_type);
+				sum += component->value[0];
+				++count;
+			}
+		}
+		best = __min(best, timer_get_ticks() - start);
+		s_bench_sink = sum;
+		*match_count = count;
+	}
+	return best;
+}
+
+static void bench_query(bench_results_t* results, heap_t* heap)
+{
+	static const char* k_variants[] = { "adhoc", "registered", "chunk" };
+
+	for (int c = 0; c < _countof(k_entity_counts); ++c)
+	{
+		for (int d = 0; d < _countof(k_densities); ++d)
+		{
+			for (int s = 0; s < _countof(k_storages); ++s)
+			{
+				bench_world_t world;
+				bench_world_create(&world, heap, k_entity_counts[c], 0, k_storages[s]);
+				bench_world_populate(&world, k_densities[d]);
+				int registered_query = ecs_query_register(world.ecs, world.query_mask);
+
+				for (int v = 0; v < _countof(k_variants); ++v)
+				{
+					// Sparse components are not stored by entity, so they have no chunk columns.
+					if (v == 2 && k_storages[s] == k_ecs_storage_sparse)
+					{
+						continue;
+					}
+					int matches = 0;
+					uint64_t ticks = time_query(&world, v, registered_query, &matches);
+					results_add(results, "query", k_variants[v], k_storages[s], k_entity_counts[c], k_densities[d], matches, ticks);
+				}
+
+				bench_world_destroy(&world, heap);
+			}
+		}
+	}
+}
+
+static void bench_random_access(bench_results_t* results, heap_t* heap)
+{
+	for (int c = 0; c < _countof(k_entity_counts); ++c)
+	{
+		for (int s = 0; s < _countof(k_storages); ++s)
+		{
+			int count = k_entity_counts[c];
+			bench_world_t world;
+			bench_world_create(&world, heap, count, 0, k_storages[s]);
+			bench_world_populate(&world, 100);
+
+			// Visit entities in a shuffled order so accesses defeat the prefetcher.
+			int* order = heap_alloc(heap, sizeof(int) * count, 8);
+			for (int i = 0; i < count; ++i)
+			{
+				order[i] = i;
+			}
+			uint32_t seed = 54321;
+			for (int i = count - 1; i > 0; --i)
+			{
+				seed = seed * 1664525 + 1013904223;
+				int j = (int)((seed >> 8) % (uint32_t)(i + 1));
+				int temp = order[i];
+				order[i] = order[j];
+				order[j] = temp;
+			}
+
+			uint64_t best_read = UINT64_MAX;
+			uint64_t best_write = UINT64_MAX;
+			for (int r = 0; r < k_bench_repeat; ++r)
+			{
+				float sum = 0.0f;
+				uint64_t start = timer_get_ticks();
+				for (int i = 0; i < count; ++i)
+				{
+					const bench_component_t* component = ecs_entity_read_component(world.ecs, world.refs[order[i]], world.some_type, false);
+					sum += component->value[0];
+				}
+				best_read = __min(best_read, timer_get_ticks() - start);
+				s_bench_sink = sum;
+
+				start = timer_get_ticks();
+				for (int i = 0; i < count; ++i)
+				{
+					bench_component_t* component = ecs_entity_get_component(world.ecs, world.refs[order[i]], world.some_type, false);
+					component->value[0] += 1.0f;
+				}
+				best_write = __min(best_write, timer_get_ticks() - start);
+			}
+			results_add(results, "random_access", "read", k_storages[s], count, 100, count, best_read);
+			results_add(results, "random_access", "write", k_storages[s], count, 100, count, best_write);
+
+			heap_free(heap, order);
+			bench_world_destroy(&world, heap);
+		}
+	}
+}
+
+static void bench_update(bench_results_t* results, heap_t* heap)
+{
+	for (int c = 0; c < _countof(k_entity_counts); ++c)
+	{
+		for (int s = 0; s < _countof(k_storages); ++s)
+		{
+			int count = k_entity_counts[c];
+			int density_percent = 50;
+			int churn = __max(1, count * k_bench_churn_percent / 100);
+			bench_world_t world;
+			bench_world_create(&world, heap, count, churn, k_storages[s]);
+			bench_world_populate(&world, density_percent);
+			ecs_query_register(world.ecs, world.query_mask);
+
+			uint64_t best_idle = UINT64_MAX;
+			for (int r = 0; r < k_bench_repeat; ++r)
+			{
+				uint64_t start = timer_get_ticks();
+				ecs_update(world.ecs);
+				best_idle = __min(best_idle, timer_get_ticks() - start);
+			}
+
+			// Each frame removes a window of entities and respawns them; only the update is timed.
+			uint64_t best_churn = UINT64_MAX;
+			for (int r = 0; r < k_bench_repeat; ++r)
+			{
+				int first = (r * churn) % count;
+				for (int i = 0; i < churn; ++i)
+				{
+					ecs_entity_remove(world.ecs, world.refs[(first + i) % count], false);
+				}
+				for (int i = 0; i < churn; ++i)
+				{
+					world.refs[(first + i) % count] = ecs_entity_add(world.ecs, (i & 1) ? world.query_mask : world.all_mask);
+				}
+				uint64_t start = timer_get_ticks();
+				ecs_update(world.ecs);
+				best_churn = __min(best_churn, timer_get_ticks() - start);
+			}
+
+			results_add(results, "update", "idle", k_storages[s], count, density_percent, 1, best_idle);
+			results_add(results, "update", "churn", k_storages[s], count, density_percent, 1, best_churn);
+
+			bench_world_destroy(&world, heap);
+		}
+	}
+}
+
+bool ecs_bench_run(heap_t* heap, fs_t* fs, const char* csv_path)
+{
+	bench_results_t results = { .heap = heap };
+	const char* header = "suite,variant,storage,entities,density_percent,ops,ns_total,ns_per_op\n";
+	results_append(&results, header, strlen(header));
+
+	bench_spawn_despawn(&results, heap);
+	bench_query(&results, heap);
+	bench_random_access(&results, heap);
+	bench_update(&results, heap);
+
+	fs_work_t* work = fs_write(fs, csv_path, results.text, results.size, false);
+	fs_work_wait(work);
+	bool written = fs_work_get_result(work) == 0;
+	fs_work_destroy(work);
+	heap_free(heap, results.text);
+
+	if (!written)
+	{
+		debug_print(k_print_error, "Failed to write ECS benchmark results to %s\n", csv_path);
+	}
+	return written;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Entity component system benchmarks.
+// Runs headless: needs only a heap, timer, and file system, no window or GPU.
+
+#include <stdbool.h>
+
+typedef struct fs_t fs_t;
+typedef struct heap_t heap_t;
+
+// Run every ECS benchmark and write the results to a CSV file.
+// Covers spawn and despawn throughput, query iteration over 1k to 1M entities at several
+// match densities, random component access by entity reference, and ecs_update() cost,
+// each with paged and sparse storage for the measured component.
+// Columns: suite,variant,storage,entities,density_percent,ops,ns_total,ns_per_op
+// Each row is the best of several runs. Rows are also logged with debug_print().
+// Returns true if the file was written.
+bool ecs_bench_run(heap_t* heap, fs_t* fs, const char* csv_path);
@@ -0,0 +1,158 @@
+#pragma once
+
+// Entity Component System Masks
+// Fixed-width bitsets with one bit per component type.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <intrin.h>
+
+enum
+{
+	// Number of 64-bit words in a mask.
+	k_ecs_mask_words = 2,
+	// Number of component types a mask can hold.
+	k_ecs_max_component_types = k_ecs_mask_words * 64,
+};
+
+// Set of component types.
+typedef struct ecs_mask_t
+{
+	uint64_t words[k_ecs_mask_words];
+} ecs_mask_t;
+
+// Returns a mask with no component types.
+__forceinline ecs_mask_t ecs_mask_none()
+{
+	return (ecs_mask_t) { 0 };
+}
+
+// Returns a mask with only the given component type.
+__forceinline ecs_mask_t ecs_mask_bit(int type)
+{
+	ecs_mask_t mask = { 0 };
+	mask.words[type >> 6] = 1ULL << (type & 63);
+	return mask;
+}
+
+// Adds a component type to a mask.
+__forceinline void ecs_mask_add(ecs_mask_t* mask, int type)
+{
+	mask->words[type >> 6] |= 1ULL << (type & 63);
+}
+
+// Removes a component type from a mask.
+__forceinline void ecs_mask_remove(ecs_mask_t* mask, int type)
+{
+	mask->words[type >> 6] &= ~(1ULL << (type & 63));
+}
+
+// Determines if a mask has a component type.
+__forceinline bool ecs_mask_test(ecs_mask_t mask, int type)
+{
+	return (mask.words[type >> 6] & (1ULL << (type & 63))) != 0;
+}
+
+// Returns the types in either mask.
+__forceinline ecs_mask_t ecs_mask_or(ecs_mask_t a, ecs_mask_t b)
+{
+	ecs_mask_t result;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		result.words[i] = a.words[i] | b.words[i];
+	}
+	return result;
+}
+
+// Returns the types in both masks.
+__forceinline ecs_mask_t ecs_mask_and(ecs_mask_t a, ecs_mask_t b)
+{
+	ecs_mask_t result;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		result.words[i] = a.words[i] & b.words[i];
+	}
+	return result;
+}
+
+// Returns the types in a that are not in b.
+__forceinline ecs_mask_t ecs_mask_and_not(ecs_mask_t a, ecs_mask_t b)
+{
+	ecs_mask_t result;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		result.words[i] = a.words[i] & ~b.words[i];
+	}
+	return result;
+}
+
+// Determines if a mask has no types.
+__forceinline bool ecs_mask_is_empty(ecs_mask_t mask)
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		bits |= mask.words[i];
+	}
+	return bits == 0;
+}
+
+// Determines if two masks have the same types.
+__forceinline bool ecs_mask_equal(ecs_mask_t a, ecs_mask_t b)
+{
+	uint64_t diff = 0;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		diff |= a.words[i] ^ b.words[i];
+	}
+	return diff == 0;
+}
+
+// Determines if every type in subset is also in mask.
+__forceinline bool ecs_mask_contains(ecs_mask_t mask, ecs_mask_t subset)
+{
+	uint64_t missing = 0;
+	for (int i = 0; i < k_ecs_mask_words; ++i)
+	{
+		missing |= subset.words[i] & ~mask.words[i];
+	}
+	return missing == 0;
+}
+
+// Determines if two masks share any type.
+__forceinline bool ecs_mask_intersects(ecs_mask_t a, ecs_mask_t b)
+{
+	return !ecs_mask_is_empty(ecs_mask_and(a, b));
+}
+
+// Returns the first type in the mask that is at least type, or -1 if there are none.
+// Visit every type with: for (int t = ecs_mask_next(mask, 0); t >= 0; t = ecs_mask_next(mask, t + 1))
+__forceinline int ecs_mask_next(ecs_mask_t mask, int type)
+{
+	int word = type >> 6;
+	if (word >= k_ecs_mask_words)
+	{
+		return -1;
+	}
+	uint64_t bits = mask.words[word] & (~0ULL << (type & 63));
+	while (!bits)
+	{
+		if (++word >= k_ecs_mask_words)
+		{
+			return -1;
+		}
+		bits = mask.words[word];
+	}
+	unsigned long index;
+#if defined(_M_X64)
+	_BitScanForward64(&index, bits);
+#else
+	if (!_BitScanForward(&index, (unsigned long)bits))
+	{
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		index += 32;
+	}
+#endif
+	return word * 64 + (int)index;
+}
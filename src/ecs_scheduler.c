@@ -0,0 +1,198 @@
+#include "ecs_scheduler.h"
+
+#include "atomic.h"
+#include "debug.h"
+#include "ecs.h"
+#include "heap.h"
+#include "queue.h"
+#include "semaphore.h"
+#include "thread.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+enum
+{
+	k_max_systems = 64,
+	k_max_workers = 64,
+};
+
+typedef struct ecs_system_t
+{
+	char name[32];
+	ecs_system_function_t function;
+	void* user;
+	ecs_mask_t read_mask;
+	ecs_mask_t write_mask;
+	ecs_cmd_buffer_t* commands;
+
+	// Bit i is set if system i must wait for this system to finish.
+	uint64_t dependents;
+	int dependency_count;
+	int pending;
+} ecs_system_t;
+
+typedef struct ecs_scheduler_t
+{
+	heap_t* heap;
+	ecs_t* ecs;
+	trace_t* trace;
+	queue_t* ready_queue;
+	semaphore_t* done;
+	thread_t* workers[k_max_workers];
+	int worker_count;
+	ecs_system_t systems[k_max_systems];
+	int system_count;
+} ecs_scheduler_t;
+
+static int worker_thread_func(void* user);
+
+ecs_scheduler_t* ecs_scheduler_create(heap_t* heap, ecs_t* ecs, trace_t* trace, int worker_count)
+{
+	ecs_scheduler_t* scheduler = heap_alloc(heap, sizeof(ecs_scheduler_t), 8);
+	memset(scheduler, 0, sizeof(*scheduler));
+	scheduler->heap = heap;
+	scheduler->ecs = ecs;
+	scheduler->trace = trace;
+	scheduler->ready_queue = queue_create(heap, k_max_systems + k_max_workers);
+	scheduler->done = semaphore_create(0, k_max_systems);
+	scheduler->worker_count = __max(0, __min(worker_count, k_max_workers));
+	for (int i = 0; i < scheduler->worker_count; i++)
+	{
+		scheduler->workers[i] = thread_create(worker_thread_func, scheduler);
+	}
+	return scheduler;
+}
+
+void ecs_scheduler_destroy(ecs_scheduler_t* scheduler)
+{
+	for (int i = 0; i < scheduler->worker_count; i++)
+	{
+		queue_push(scheduler->ready_queue, NULL);
+	}
+	for (int i = 0; i < scheduler->worker_count; i++)
+	{
+		thread_destroy(scheduler->workers[i]);
+	}
+	for (int i = scheduler->system_count - 1; i >= 0; i--)
+	{
+		ecs_cmd_buffer_destroy(scheduler->systems[i].commands);
+	}
+	queue_destroy(scheduler->ready_queue);
+	semaphore_destroy(scheduler->done);
+	heap_free(scheduler->heap, scheduler);
+}
+
+int ecs_scheduler_add_system(ecs_scheduler_t* scheduler, const char* name, ecs_system_function_t function, void* user, ecs_mask_t read_mask, ecs_mask_t write_mask)
+{
+	if (scheduler->system_count >= k_max_systems)
+	{
+		debug_print(k_print_warning, "Out of ECS system slots, %s not added.\n", name);
+		return -1;
+	}
+
+	ecs_system_t* system = &scheduler->systems[scheduler->system_count];
+	memset(system, 0, sizeof(*system));
+	strcpy_s(system->name, sizeof(system->name), name);
+	system->function = function;
+	system->user = user;
+	system->read_mask = read_mask;
+	system->write_mask = write_mask;
+	system->commands = ecs_cmd_buffer_create(scheduler->ecs);
+	return scheduler->system_count++;
+}
+
+static bool systems_conflict(const ecs_system_t* a, const ecs_system_t* b)
+{
+	return ecs_mask_intersects(a->write_mask, ecs_mask_or(b->read_mask, b->write_mask)) || ecs_mask_intersects(a->read_mask, b->write_mask);
+}
+
+static void build_dependencies(ecs_scheduler_t* scheduler)
+{
+	for (int i = 0; i < scheduler->system_count; i++)
+	{
+		ecs_system_t* system = &scheduler->systems[i];
+		system->dependents = 0;
+		system->dependency_count = 0;
+		for (int j = 0; j < i; j++)
+		{
+			if (systems_conflict(&scheduler->systems[j], system))
+			{
+				scheduler->systems[j].dependents |= 1ULL << i;
+				system->dependency_count++;
+			}
+		}
+	}
+}
+
+static void run_system(ecs_scheduler_t* scheduler, ecs_system_t* system)
+{
+	if (scheduler->trace)
+	{
+		trace_duration_push(scheduler->trace, system->name);
+	}
+	system->function(system->user, system->commands);
+	if (scheduler->trace)
+	{
+		trace_duration_pop(scheduler->trace);
+	}
+
+	for (int i = 0; i < scheduler->system_count; i++)
+	{
+		if ((system->dependents & (1ULL << i)) && atomic_decrement(&scheduler->systems[i].pending) == 1)
+		{
+			queue_push(scheduler->ready_queue, &scheduler->systems[i]);
+		}
+	}
+	semaphore_release(scheduler->done);
+}
+
+void ecs_scheduler_run(ecs_scheduler_t* scheduler)
+{
+	build_dependencies(scheduler);
+
+	for (int i = 0; i < scheduler->system_count; i++)
+	{
+		atomic_store(&scheduler->systems[i].pending, scheduler->systems[i].dependency_count);
+	}
+	for (int i = 0; i < scheduler->system_count; i++)
+	{
+		if (scheduler->systems[i].dependency_count == 0)
+		{
+			queue_push(scheduler->ready_queue, &scheduler->systems[i]);
+		}
+	}
+
+	// The calling thread helps run systems until none are ready, then waits
+	// for the workers to report completion.
+	int remaining = scheduler->system_count;
+	while (remaining > 0)
+	{
+		ecs_system_t* system = queue_try_pop(scheduler->ready_queue);
+		if (system)
+		{
+			run_system(scheduler, system);
+		}
+		else
+		{
+			semaphore_acquire(scheduler->done);
+			remaining--;
+		}
+	}
+}
+
+static int worker_thread_func(void* user)
+{
+	ecs_scheduler_t* scheduler = user;
+	while (true)
+	{
+		ecs_system_t* system = queue_pop(scheduler->ready_queue);
+		if (system == NULL)
+		{
+			break;
+		}
+		run_system(scheduler, system);
+	}
+	return 0;
+}
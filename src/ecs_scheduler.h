@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ecs_mask.h"
+
+#include <stdint.h>
+
+// ECS System Scheduler
+// Systems declare which component types they read and write.
+// Each frame the scheduler orders systems by those declarations and runs
+// systems that do not conflict on worker threads in parallel.
+
+// Handle to a system scheduler.
+typedef struct ecs_scheduler_t ecs_scheduler_t;
+
+typedef struct ecs_t ecs_t;
+typedef struct ecs_cmd_buffer_t ecs_cmd_buffer_t;
+typedef struct heap_t heap_t;
+typedef struct trace_t trace_t;
+
+// Function run once per frame for a system.
+// Structural changes (spawn, remove) must be recorded in the provided command buffer.
+typedef void (*ecs_system_function_t)(void* user, ecs_cmd_buffer_t* commands);
+
+// Create a scheduler running systems against an ECS.
+// Worker count is the number of threads created in addition to the calling thread.
+// If trace is not NULL, a trace duration is recorded for each system run.
+ecs_scheduler_t* ecs_scheduler_create(heap_t* heap, ecs_t* ecs, trace_t* trace, int worker_count);
+
+// Destroy a scheduler and stop its worker threads.
+void ecs_scheduler_destroy(ecs_scheduler_t* scheduler);
+
+// Register a system with the component types it reads and writes.
+// Systems that conflict keep their registration order; others may run in parallel.
+// Returns the system index, or -1 on failure.
+int ecs_scheduler_add_system(ecs_scheduler_t* scheduler, const char* name, ecs_system_function_t function, void* user, ecs_mask_t read_mask, ecs_mask_t write_mask);
+
+// Run all registered systems and wait for them to complete.
+// Recorded commands are played back on the next ecs_update.
+void ecs_scheduler_run(ecs_scheduler_t* scheduler);
@@ -7,9 +7,13 @@
 #include "timer_object.h"
 #include "input.h"
 #include "ecs.h"
+#include "ecs_scheduler.h"
 #include "heap.h"
 #include "wm.h"
 #include "collide.h"
+#include "thread.h"
+#include "transform_hierarchy.h"
+#include "frustum.h"
 #include "string.h"
 
 typedef struct transform_component_t
@@ -32,6 +36,8 @@ typedef struct model_component_t
 {
 	gpu_mesh_info_t* mesh_info;
 	gpu_shader_info_t* shader_info;
+	// Half size of the mesh's box around its origin, for culling.
+	vec3f_t bounds;
 } model_component_t;
 
 typedef struct enemy_component_t
@@ -42,11 +48,6 @@ typedef struct enemy_component_t
 	bool respawning;
 } enemy_component_t;
 
-typedef struct name_component_t
-{
-	char name[32];
-} name_component_t;
-
 typedef struct collider_component_t {
 	collide_t collider;
 } collider_component_t;
@@ -61,17 +62,27 @@ typedef struct frogger_t
 	timer_object_t* timer;
 
 	ecs_t* ecs;
+	ecs_scheduler_t* scheduler;
+	transform_hierarchy_t* hierarchy;
+	collide_grid_t* collide_grid;
 	int transform_type;
+	int world_type;
 	int camera_type;
 	int model_type;
 	int player_type;
-	int name_type;
 	int collider_type;
 	int enemy_type;
+	int player_query;
+	ecs_mask_t enemy_mask;
+	ecs_mask_t enemy_collider_mask;
+	int camera_query;
+	ecs_mask_t model_mask;
 	bool playerRespawning;
+	frogger_draw_stats_t draw_stats;
 	ecs_entity_ref_t player_ent;
 	ecs_entity_ref_t camera_ent;
 	ecs_entity_ref_t enemy_ent[3][5];
+	int enemy_prefabs[3];
 
 	gpu_mesh_info_t cube_mesh;
 	gpu_mesh_info_t rect_mesh;
@@ -83,11 +94,15 @@ typedef struct frogger_t
 static void load_resources(frogger_t* game);
 static void unload_resources(frogger_t* game);
 static void spawn_player(frogger_t* game);
-static void spawn_enemy(frogger_t* game, int index, int row, bool respawn);
+static void fixup_models(void* user, void* components, int count, bool is_load);
+static void create_enemy_prefabs(frogger_t* game);
+static void spawn_enemies(frogger_t* game);
+static void respawn_enemy(frogger_t* game, ecs_cmd_buffer_t* commands, int index, int row);
 static void spawn_camera(frogger_t* game);
-static void update_players(frogger_t* game);
-static void update_enemies(frogger_t* game);
-static void draw_models(frogger_t* game);
+static void update_players(void* user, ecs_cmd_buffer_t* commands);
+static void update_enemies(void* user, ecs_cmd_buffer_t* commands);
+static void update_transforms(void* user, ecs_cmd_buffer_t* commands);
+static void draw_models(void* user, ecs_cmd_buffer_t* commands);
 
 frogger_t* frogger_create(heap_t* heap, fs_t* fs, wm_window_t* window, render_t* render, input_t* input)
 {
@@ -99,23 +114,56 @@ frogger_t* frogger_create(heap_t* heap, fs_t* fs, wm_window_t* window, render_t*
 
 	game->timer = timer_object_create(heap, NULL);
 
-	game->ecs = ecs_create(heap);
-	game->transform_type = ecs_register_component_type(game->ecs, "transform", sizeof(transform_component_t), _Alignof(transform_component_t));
-	game->camera_type = ecs_register_component_type(game->ecs, "camera", sizeof(camera_component_t), _Alignof(camera_component_t));
-	game->model_type = ecs_register_component_type(game->ecs, "model", sizeof(model_component_t), _Alignof(model_component_t));
-	game->player_type = ecs_register_component_type(game->ecs, "player", sizeof(player_component_t), _Alignof(player_component_t));
-	game->name_type = ecs_register_component_type(game->ecs, "name", sizeof(name_component_t), _Alignof(name_component_t));
-	game->collider_type = ecs_register_component_type(game->ecs, "collider", sizeof(collider_component_t), _Alignof(collider_component_t));
-	game->enemy_type = ecs_register_component_type(game->ecs, "enemy", sizeof(enemy_component_t), _Alignof(enemy_component_t));
+	game->ecs = ecs_create(heap, 64 * 1024);
+	game->transform_type = ecs_register_component_type(game->ecs, "transform", sizeof(transform_component_t), _Alignof(transform_component_t), k_ecs_storage_paged);
+	game->camera_type = ecs_register_component_type(game->ecs, "camera", sizeof(camera_component_t), _Alignof(camera_component_t), k_ecs_storage_sparse);
+	game->model_type = ecs_register_component_type(game->ecs, "model", sizeof(model_component_t), _Alignof(model_component_t), k_ecs_storage_paged);
+	game->player_type = ecs_register_component_type(game->ecs, "player", sizeof(player_component_t), _Alignof(player_component_t), k_ecs_storage_sparse);
+	game->collider_type = ecs_register_component_type(game->ecs, "collider", sizeof(collider_component_t), _Alignof(collider_component_t), k_ecs_storage_paged);
+	game->enemy_type = ecs_register_component_type(game->ecs, "enemy", sizeof(enemy_component_t), _Alignof(enemy_component_t), k_ecs_storage_paged);
+	ecs_register_component_fixup(game->ecs, game->model_type, fixup_models, game);
+	game->hierarchy = transform_hierarchy_create(heap, game->ecs, game->transform_type);
+	game->world_type = transform_hierarchy_get_world_type(game->hierarchy);
+
+	ecs_mask_t player_mask = ecs_mask_bit(game->transform_type);
+	ecs_mask_add(&player_mask, game->player_type);
+	ecs_mask_add(&player_mask, game->collider_type);
+	game->player_query = ecs_query_register(game->ecs, player_mask);
+
+	game->enemy_mask = ecs_mask_bit(game->transform_type);
+	ecs_mask_add(&game->enemy_mask, game->enemy_type);
+	ecs_mask_add(&game->enemy_mask, game->collider_type);
+
+	game->enemy_collider_mask = ecs_mask_bit(game->enemy_type);
+	ecs_mask_add(&game->enemy_collider_mask, game->collider_type);
+	game->collide_grid = collide_grid_create(heap, 4.0f);
+
+	game->camera_query = ecs_query_register(game->ecs, ecs_mask_bit(game->camera_type));
+
+	game->model_mask = ecs_mask_bit(game->world_type);
+	ecs_mask_add(&game->model_mask, game->model_type);
+
+	game->scheduler = ecs_scheduler_create(heap, game->ecs, NULL, thread_get_core_count() - 1);
+	ecs_mask_t moved_mask = ecs_mask_bit(game->transform_type);
+	ecs_mask_add(&moved_mask, game->collider_type);
+	ecs_mask_t players_read_mask = ecs_mask_bit(game->player_type);
+	ecs_mask_add(&players_read_mask, game->enemy_type);
+	ecs_scheduler_add_system(game->scheduler, "update_players", update_players, game, players_read_mask, moved_mask);
+	ecs_scheduler_add_system(game->scheduler, "update_enemies", update_enemies, game, ecs_mask_bit(game->enemy_type), moved_mask);
+
+	ecs_mask_t transforms_read_mask = ecs_mask_bit(game->transform_type);
+	ecs_mask_add(&transforms_read_mask, transform_hierarchy_get_parent_type(game->hierarchy));
+	ecs_scheduler_add_system(game->scheduler, "update_transforms", update_transforms, game, transforms_read_mask, ecs_mask_bit(game->world_type));
+
+	ecs_mask_t draw_read_mask = game->model_mask;
+	ecs_mask_add(&draw_read_mask, game->camera_type);
+	ecs_scheduler_add_system(game->scheduler, "draw_models", draw_models, game, draw_read_mask, ecs_mask_none());
 
 	game->playerRespawning = false;
 	load_resources(game);
 	spawn_player(game);
-	for (int i = 0; i < 3; i++) {
-		for (int j = 0; j < 4; j++) {
-			spawn_enemy(game, j, i, false);
-		}
-	}
+	create_enemy_prefabs(game);
+	spawn_enemies(game);
 	spawn_camera(game);
 
 	game->input = input;
@@ -124,6 +172,9 @@ frogger_t* frogger_create(heap_t* heap, fs_t* fs, wm_window_t* window, render_t*
 
 void frogger_destroy(frogger_t* game)
 {
+	ecs_scheduler_destroy(game->scheduler);
+	transform_hierarchy_destroy(game->hierarchy);
+	collide_grid_destroy(game->collide_grid);
 	ecs_destroy(game->ecs);
 	timer_object_destroy(game->timer);
 	unload_resources(game);
@@ -138,12 +189,15 @@ void frogger_update(frogger_t* game)
 	}
 	timer_object_update(game->timer);
 	ecs_update(game->ecs);
-	update_players(game);
-	update_enemies(game);
-	draw_models(game);
+	ecs_scheduler_run(game->scheduler);
 	render_push_done(game->render);
 }
 
+frogger_draw_stats_t frogger_get_draw_stats(frogger_t* game)
+{
+	return game->draw_stats;
+}
+
 static void load_resources(frogger_t* game)
 {
 	game->vertex_shader_work = fs_read(game->fs, "shaders/triangle.vert.spv", game->heap, false, false);
@@ -222,6 +276,40 @@ static void unload_resources(frogger_t* game)
 	fs_work_destroy(game->vertex_shader_work);
 }
 
+// Snapshots store model components as mesh and shader indices instead of pointers.
+static void fixup_models(void* user, void* components, int count, bool is_load)
+{
+	frogger_t* game = user;
+	gpu_mesh_info_t* meshes[] = { NULL, &game->cube_mesh, &game->rect_mesh };
+	gpu_shader_info_t* shaders[] = { NULL, &game->cube_shader };
+
+	model_component_t* models = components;
+	for (int i = 0; i < count; i++) {
+		if (is_load) {
+			uintptr_t mesh = (uintptr_t)models[i].mesh_info;
+			uintptr_t shader = (uintptr_t)models[i].shader_info;
+			models[i].mesh_info = mesh < _countof(meshes) ? meshes[mesh] : NULL;
+			models[i].shader_info = shader < _countof(shaders) ? shaders[shader] : NULL;
+		}
+		else {
+			uintptr_t mesh = 0;
+			uintptr_t shader = 0;
+			for (uintptr_t m = 1; m < _countof(meshes); m++) {
+				if (models[i].mesh_info == meshes[m]) {
+					mesh = m;
+				}
+			}
+			for (uintptr_t s = 1; s < _countof(shaders); s++) {
+				if (models[i].shader_info == shaders[s]) {
+					shader = s;
+				}
+			}
+			models[i].mesh_info = (gpu_mesh_info_t*)mesh;
+			models[i].shader_info = (gpu_shader_info_t*)shader;
+		}
+	}
+}
+
 static void set_enemy(int row, int index, float* zpos, float* ypos, float* scale, float* speed) {
 	switch (row) {
 	case 2:
@@ -261,12 +349,12 @@ static void set_enemy(int row, int index, float* zpos, float* ypos, float* scale
 
 static void spawn_player(frogger_t* game)
 {
-	uint64_t k_player_ent_mask =
-		(1ULL << game->transform_type) |
-		(1ULL << game->model_type) |
-		(1ULL << game->player_type) |
-		(1ULL << game->name_type) |
-		(1ULL << game->collider_type);
+	ecs_mask_t k_player_ent_mask = ecs_mask_none();
+	ecs_mask_add(&k_player_ent_mask, game->transform_type);
+	ecs_mask_add(&k_player_ent_mask, game->world_type);
+	ecs_mask_add(&k_player_ent_mask, game->model_type);
+	ecs_mask_add(&k_player_ent_mask, game->player_type);
+	ecs_mask_add(&k_player_ent_mask, game->collider_type);
 	game->player_ent = ecs_entity_add(game->ecs, k_player_ent_mask);
 
 	transform_component_t* transform_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->transform_type, true);
@@ -274,8 +362,7 @@ static void spawn_player(frogger_t* game)
 	transform_comp->transform.translation.z = 7.5f;
 
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "player");
+	ecs_entity_set_name(game->ecs, game->player_ent, "player");
 
 	player_component_t* player_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->player_type, true);
 	player_comp->player_speed = 5.0f;
@@ -283,62 +370,109 @@ static void spawn_player(frogger_t* game)
 	model_component_t* model_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->model_type, true);
 	model_comp->mesh_info = &game->cube_mesh;
 	model_comp->shader_info = &game->cube_shader;
+	model_comp->bounds = (vec3f_t){ .x = 1.0f, .y = 1.0f, .z = 1.0f };
 
 	collider_component_t* collide_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->collider_type, true);
 	set_collider(&collide_comp->collider, &transform_comp->transform);
 }
 
-static void spawn_enemy(frogger_t* game, int index, int row, bool respawn)
+static void create_enemy_prefabs(frogger_t* game)
+{
+	ecs_mask_t k_enemy_ent_mask = ecs_mask_none();
+	ecs_mask_add(&k_enemy_ent_mask, game->transform_type);
+	ecs_mask_add(&k_enemy_ent_mask, game->world_type);
+	ecs_mask_add(&k_enemy_ent_mask, game->model_type);
+	ecs_mask_add(&k_enemy_ent_mask, game->enemy_type);
+	ecs_mask_add(&k_enemy_ent_mask, game->collider_type);
+
+	for (int row = 0; row < 3; row++) {
+		int prefab = ecs_prefab_register(game->ecs, k_enemy_ent_mask);
+
+		float zposition;
+		float yposition;
+		float scale;
+		float speed;
+		set_enemy(row, 0, &zposition, &yposition, &scale, &speed);
+
+		transform_component_t* transform_comp = ecs_prefab_get_component(game->ecs, prefab, game->transform_type);
+		transform_identity(&transform_comp->transform);
+		transform_comp->transform.translation = (vec3f_t){ .x = 0, .y = 0, .z = zposition };
+		transform_comp->transform.scale.y = scale;
+
+		ecs_prefab_set_name(game->ecs, prefab, "enemy");
+
+		enemy_component_t* enemy_comp = ecs_prefab_get_component(game->ecs, prefab, game->enemy_type);
+		enemy_comp->row = row;
+		enemy_comp->speed = speed;
+
+		model_component_t* model_comp = ecs_prefab_get_component(game->ecs, prefab, game->model_type);
+		model_comp->mesh_info = &game->rect_mesh;
+		model_comp->shader_info = &game->cube_shader;
+		model_comp->bounds = (vec3f_t){ .x = 1.0f, .y = 1.0f, .z = 1.0f };
+
+		collider_component_t* collide_comp = ecs_prefab_get_component(game->ecs, prefab, game->collider_type);
+		set_collider(&collide_comp->collider, &transform_comp->transform);
+
+		game->enemy_prefabs[row] = prefab;
+	}
+}
+
+// Set the per-enemy parts of components copied from a row's prefab.
+static void place_enemy(frogger_t* game, transform_component_t* transform_comp, enemy_component_t* enemy_comp, collider_component_t* collide_comp, int index, bool respawn)
 {
-	uint64_t k_player_ent_mask =
-		(1ULL << game->transform_type) |
-		(1ULL << game->model_type) |
-		(1ULL << game->enemy_type) |
-		(1ULL << game->name_type) |
-		(1ULL << game->collider_type);
-	game->enemy_ent[row][index] = ecs_entity_add(game->ecs, k_player_ent_mask);
-
-	transform_component_t* transform_comp = ecs_entity_get_component(game->ecs, game->enemy_ent[row][index], game->transform_type, true);
-	transform_identity(&transform_comp->transform);
 	float zposition;
 	float yposition;
 	float scale;
 	float speed;
-	set_enemy(row, index, &zposition, &yposition, &scale, &speed);
-	
+	set_enemy(enemy_comp->row, index, &zposition, &yposition, &scale, &speed);
+
 	if (respawn) {
 		yposition = 16.8f;
 	}
 
-	transform_comp->transform.translation = (vec3f_t){.x = 0, .y = yposition, .z = zposition};
-	transform_comp->transform.scale.y = scale;
+	transform_comp->transform.translation.y = yposition;
+	enemy_comp->index = index;
+	set_collider(&collide_comp->collider, &transform_comp->transform);
+}
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->enemy_ent[row][index], game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "enemy");
+static void spawn_enemies(frogger_t* game)
+{
+	for (int row = 0; row < 3; row++) {
+		int count = ecs_entity_add_many(game->ecs, game->enemy_prefabs[row], 4, game->enemy_ent[row]);
+		for (int index = 0; index < count; index++) {
+			ecs_entity_ref_t ref = game->enemy_ent[row][index];
+			place_enemy(game,
+				ecs_entity_get_component(game->ecs, ref, game->transform_type, true),
+				ecs_entity_get_component(game->ecs, ref, game->enemy_type, true),
+				ecs_entity_get_component(game->ecs, ref, game->collider_type, true),
+				index, false);
+		}
+	}
+}
 
-	enemy_component_t* enemy_comp = ecs_entity_get_component(game->ecs, game->enemy_ent[row][index], game->enemy_type, true);
-	enemy_comp->index = index;
-	enemy_comp->row = row;
-	enemy_comp->speed = speed;
+static void respawn_enemy(frogger_t* game, ecs_cmd_buffer_t* commands, int index, int row)
+{
+	int prefab = game->enemy_prefabs[row];
+	int spawn = ecs_cmd_buffer_spawn_prefab(commands, prefab, &game->enemy_ent[row][index]);
 
-	model_component_t* model_comp = ecs_entity_get_component(game->ecs, game->enemy_ent[row][index], game->model_type, true);
-	model_comp->mesh_info = &game->rect_mesh;
-	model_comp->shader_info = &game->cube_shader;
+	transform_component_t* transform_comp = ecs_cmd_buffer_spawn_component(commands, spawn, game->transform_type);
+	*transform_comp = *(transform_component_t*)ecs_prefab_get_component(game->ecs, prefab, game->transform_type);
 
-	collider_component_t* collide_comp = ecs_entity_get_component(game->ecs, game->enemy_ent[row][index], game->collider_type, true);
-	set_collider(&collide_comp->collider, &transform_comp->transform);
-}
+	enemy_component_t* enemy_comp = ecs_cmd_buffer_spawn_component(commands, spawn, game->enemy_type);
+	*enemy_comp = *(enemy_component_t*)ecs_prefab_get_component(game->ecs, prefab, game->enemy_type);
+
+	collider_component_t* collide_comp = ecs_cmd_buffer_spawn_component(commands, spawn, game->collider_type);
+	*collide_comp = *(collider_component_t*)ecs_prefab_get_component(game->ecs, prefab, game->collider_type);
 
+	place_enemy(game, transform_comp, enemy_comp, collide_comp, index, true);
+}
 
 static void spawn_camera(frogger_t* game)
 {
-	uint64_t k_camera_ent_mask =
-		(1ULL << game->camera_type) |
-		(1ULL << game->name_type);
+	ecs_mask_t k_camera_ent_mask = ecs_mask_bit(game->camera_type);
 	game->camera_ent = ecs_entity_add(game->ecs, k_camera_ent_mask);
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "camera");
+	ecs_entity_set_name(game->ecs, game->camera_ent, "camera");
 
 	camera_component_t* camera_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->camera_type, true);
 	mat4f_make_orthographic(&camera_comp->projection, -16.0f, 16.0f, -9.0f, 9.0f, 0.1f, 100.0f);
@@ -349,70 +483,76 @@ static void spawn_camera(frogger_t* game)
 	mat4f_make_lookat(&camera_comp->view, &eye_pos, &forward, &up);
 }
 
+// Insert the player and every enemy into the broadphase grid, and look for a pair with the player in it.
 static bool collide_check(frogger_t* game, collider_component_t* player_col) {
-	uint64_t k_query_mask = (1ULL << game->enemy_type) | (1ULL << game->collider_type);
-	for (ecs_query_t query = ecs_query_create(game->ecs, k_query_mask);
-		ecs_query_is_valid(game->ecs, &query);
-		ecs_query_next(game->ecs, &query)) {
-		collider_component_t* enemy_col = ecs_query_get_component(game->ecs, &query, game->collider_type);
+	collide_grid_clear(game->collide_grid);
+	int player_index = collide_grid_insert(game->collide_grid, &player_col->collider);
+
+	for (ecs_chunk_query_t chunk = ecs_chunk_query_create(game->ecs, game->enemy_collider_mask);
+		ecs_chunk_query_is_valid(game->ecs, &chunk);
+		ecs_chunk_query_next(game->ecs, &chunk)) {
+		const collider_component_t* enemy_cols = ecs_chunk_query_read_column(game->ecs, &chunk, game->collider_type);
+		for (int i = 0; i < chunk.count; i++) {
+			collide_grid_insert(game->collide_grid, &enemy_cols[i].collider);
+		}
+	}
 
-		if (intersecting(&player_col->collider, &enemy_col->collider)) {
+	int pair_count;
+	const collide_pair_t* pairs = collide_grid_find_pairs(game->collide_grid, &pair_count);
+	for (int i = 0; i < pair_count; i++) {
+		if (pairs[i].a == player_index || pairs[i].b == player_index) {
 			return true;
 		}
 	}
 	return false;
 }
 
-static void update_enemies(frogger_t* game)
+static void update_enemies(void* user, ecs_cmd_buffer_t* commands)
 {
+	frogger_t* game = user;
 	float dt = (float)timer_object_get_delta_ms(game->timer) * 0.001f;
 
 	uint32_t key_mask = wm_get_key_mask(game->window);
 
-	uint64_t k_query_mask = (1ULL << game->transform_type) | (1ULL << game->enemy_type) | (1ULL << game->collider_type);
-
-	for (ecs_query_t query = ecs_query_create(game->ecs, k_query_mask);
-		ecs_query_is_valid(game->ecs, &query);
-		ecs_query_next(game->ecs, &query))
+	for (ecs_chunk_query_t chunk = ecs_chunk_query_create(game->ecs, game->enemy_mask);
+		ecs_chunk_query_is_valid(game->ecs, &chunk);
+		ecs_chunk_query_next(game->ecs, &chunk))
 	{
-		transform_component_t* transform_comp = ecs_query_get_component(game->ecs, &query, game->transform_type);
-		enemy_component_t* enemy_comp = ecs_query_get_component(game->ecs, &query, game->enemy_type);
-		collider_component_t* collide_comp = ecs_query_get_component(game->ecs, &query, game->collider_type);
+		transform_component_t* transforms = ecs_chunk_query_get_column(game->ecs, &chunk, game->transform_type);
+		const enemy_component_t* enemies = ecs_chunk_query_read_column(game->ecs, &chunk, game->enemy_type);
+		collider_component_t* colliders = ecs_chunk_query_get_column(game->ecs, &chunk, game->collider_type);
 
-		float enemy_speed = enemy_comp->speed;
-		float dist = dt * -enemy_speed;
-		if (transform_comp->transform.translation.y < -16.8f)
+		for (int i = 0; i < chunk.count; i++)
 		{
-			int row = enemy_comp->row;
-			int index = enemy_comp->index;
-			ecs_entity_remove(game->ecs, ecs_query_get_entity(game->ecs, &query), false);
-			spawn_enemy(game, index, row, true);
-		}
+			float enemy_speed = enemies[i].speed;
+			float dist = dt * -enemy_speed;
+			if (transforms[i].transform.translation.y < -16.8f)
+			{
+				ecs_cmd_buffer_remove(commands, ecs_chunk_query_get_entity(game->ecs, &chunk, i));
+				respawn_enemy(game, commands, enemies[i].index, enemies[i].row);
+			}
 
-		transform_t move;
-		transform_identity(&move);
-		move.translation = vec3f_add(move.translation, vec3f_scale(vec3f_right(), dist));
-		transform_multiply(&transform_comp->transform, &move);
-		set_collider(&collide_comp->collider, &transform_comp->transform);
+			transforms[i].transform.translation.y += dist;
+			set_collider(&colliders[i].collider, &transforms[i].transform);
+		}
 	}
 }
 
-static void update_players(frogger_t* game)
+static void update_players(void* user, ecs_cmd_buffer_t* commands)
 {
+	frogger_t* game = user;
 	float dt = (float)timer_object_get_delta_ms(game->timer) * 0.001f;
 	float end_dist = -8.0f;
 
 	uint32_t key_mask = input_get_key_mask(game->input);
 
-	uint64_t k_query_mask = (1ULL << game->transform_type) | (1ULL << game->player_type) | (1ULL << game->collider_type);
-
-	for (ecs_query_t query = ecs_query_create(game->ecs, k_query_mask);
+	for (ecs_query_t query = ecs_query_create_registered(game->ecs, game->player_query);
 		ecs_query_is_valid(game->ecs, &query);
 		ecs_query_next(game->ecs, &query))
 	{
 		
-		transform_component_t* transform_comp = ecs_query_get_component(game->ecs, &query, game->transform_type);
-		player_component_t* player_comp = ecs_query_get_component(game->ecs, &query, game->player_type);
+		const transform_component_t* transform_comp = ecs_query_read_component(game->ecs, &query, game->transform_type);
+		const player_component_t* player_comp = ecs_query_read_component(game->ecs, &query, game->player_type);
 		collider_component_t* collide_comp = ecs_query_get_component(game->ecs, &query, game->collider_type);
 
 		float player_speed = player_comp->player_speed;
@@ -435,45 +575,90 @@ static void update_players(frogger_t* game)
 		{
 			move.translation = vec3f_add(move.translation, vec3f_scale(vec3f_right(), dist));
 		}
-		transform_multiply(&transform_comp->transform, &move);
-		set_collider(&collide_comp->collider, &transform_comp->transform);
-		if (transform_comp->transform.translation.z < end_dist || collide_check(game, collide_comp)) {
-			ecs_entity_remove(game->ecs, ecs_query_get_entity(game->ecs, &query), false);
+		// Write through the hierarchy so a player standing still keeps its cached world matrix.
+		transform_t transform = transform_comp->transform;
+		transform_multiply(&transform, &move);
+		transform_hierarchy_set_local(game->hierarchy, ecs_query_get_entity(game->ecs, &query), &transform);
+		set_collider(&collide_comp->collider, &transform);
+		if (transform.translation.z < end_dist || collide_check(game, collide_comp)) {
+			ecs_cmd_buffer_remove(commands, ecs_query_get_entity(game->ecs, &query));
 			game->playerRespawning = true;
 		}
 	}
 }
 
-static void draw_models(frogger_t* game)
+static void update_transforms(void* user, ecs_cmd_buffer_t* commands)
+{
+	frogger_t* game = user;
+	transform_hierarchy_update(game->hierarchy);
+}
+
+static void draw_models(void* user, ecs_cmd_buffer_t* commands)
 {
-	uint64_t k_camera_query_mask = (1ULL << game->camera_type);
-	for (ecs_query_t camera_query = ecs_query_create(game->ecs, k_camera_query_mask);
+	frogger_t* game = user;
+	frogger_draw_stats_t stats = { 0 };
+	for (ecs_query_t camera_query = ecs_query_create_registered(game->ecs, game->camera_query);
 		ecs_query_is_valid(game->ecs, &camera_query);
 		ecs_query_next(game->ecs, &camera_query))
 	{
-		camera_component_t* camera_comp = ecs_query_get_component(game->ecs, &camera_query, game->camera_type);
+		const camera_component_t* camera_comp = ecs_query_read_component(game->ecs, &camera_query, game->camera_type);
+		uint32_t camera_version = ecs_entity_get_component_version(game->ecs, ecs_query_get_entity(game->ecs, &camera_query), game->camera_type);
+
+		mat4f_t view_projection;
+		mat4f_mul(&view_projection, &camera_comp->view, &camera_comp->projection);
+		frustum_t frustum;
+		frustum_from_matrix(&frustum, &view_projection);
 
-		uint64_t k_model_query_mask = (1ULL << game->transform_type) | (1ULL << game->model_type);
-		for (ecs_query_t query = ecs_query_create(game->ecs, k_model_query_mask);
-			ecs_query_is_valid(game->ecs, &query);
-			ecs_query_next(game->ecs, &query))
+		for (ecs_chunk_query_t chunk = ecs_chunk_query_create(game->ecs, game->model_mask);
+			ecs_chunk_query_is_valid(game->ecs, &chunk);
+			ecs_chunk_query_next(game->ecs, &chunk))
 		{
-			transform_component_t* transform_comp = ecs_query_get_component(game->ecs, &query, game->transform_type);
-			model_component_t* model_comp = ecs_query_get_component(game->ecs, &query, game->model_type);
-			ecs_entity_ref_t entity_ref = ecs_query_get_entity(game->ecs, &query);
+			const transform_world_component_t* world_comps = ecs_chunk_query_read_column(game->ecs, &chunk, game->world_type);
+			const model_component_t* model_comps = ecs_chunk_query_read_column(game->ecs, &chunk, game->model_type);
 
-			struct
+			// Cull in batches small enough to gather on the stack, then push only what is visible.
+			enum { k_cull_batch = 64 };
+			for (int start = 0; start < chunk.count; start += k_cull_batch)
 			{
-				mat4f_t projection;
-				mat4f_t model;
-				mat4f_t view;
-			} uniform_data;
-			uniform_data.projection = camera_comp->projection;
-			uniform_data.view = camera_comp->view;
-			transform_to_matrix(&transform_comp->transform, &uniform_data.model);
-			gpu_uniform_buffer_info_t uniform_info = { .data = &uniform_data, sizeof(uniform_data) };
-
-			render_push_model(game->render, &entity_ref, model_comp->mesh_info, model_comp->shader_info, &uniform_info);
+				int count = __min(chunk.count - start, k_cull_batch);
+				mat4f_t matrices[k_cull_batch];
+				vec3f_t bounds[k_cull_batch];
+				bool visible[k_cull_batch];
+				for (int i = 0; i < count; i++)
+				{
+					matrices[i] = world_comps[start + i].matrix;
+					bounds[i] = model_comps[start + i].bounds;
+				}
+				int visible_count = frustum_cull_boxes(&frustum, matrices, bounds, count, visible);
+				stats.drawn += visible_count;
+				stats.culled += count - visible_count;
+
+				for (int i = 0; i < count; i++)
+				{
+					if (!visible[i])
+					{
+						continue;
+					}
+					const model_component_t* model_comp = &model_comps[start + i];
+					ecs_entity_ref_t entity_ref = ecs_chunk_query_get_entity(game->ecs, &chunk, start + i);
+
+					struct
+					{
+						mat4f_t projection;
+						mat4f_t model;
+						mat4f_t view;
+					} uniform_data;
+					uniform_data.projection = camera_comp->projection;
+					uniform_data.view = camera_comp->view;
+					uniform_data.model = matrices[i];
+					gpu_uniform_buffer_info_t uniform_info = { .data = &uniform_data, sizeof(uniform_data) };
+
+					// Versions share one clock, so the newer of the two changes whenever either matrix does.
+					uint32_t uniform_version = __max(world_comps[start + i].version, camera_version);
+					render_push_model(game->render, &entity_ref, model_comp->mesh_info, model_comp->shader_info, &uniform_info, uniform_version);
+				}
+			}
 		}
 	}
+	game->draw_stats = stats;
 }
@@ -7,6 +7,15 @@ typedef struct heap_t heap_t;
 typedef struct render_t render_t;
 typedef struct wm_window_t wm_window_t;
 
+// Model counts from one frame's draw.
+typedef struct frogger_draw_stats_t
+{
+	// Models pushed to the renderer.
+	int drawn;
+	// Models skipped as outside the camera's view.
+	int culled;
+} frogger_draw_stats_t;
+
 // Create an instance of simple test game.
 frogger_t* frogger_create(heap_t* heap, fs_t* fs, wm_window_t* window, render_t* render, input_t* input);
 
@@ -14,4 +23,7 @@ frogger_t* frogger_create(heap_t* heap, fs_t* fs, wm_window_t* window, render_t*
 void frogger_destroy(frogger_t* game);
 
 // Per-frame update for our simple test game.
-void frogger_update(frogger_t* game);
\ No newline at end of file
+void frogger_update(frogger_t* game);
+
+// Get the model counts from the most recent frame.
+frogger_draw_stats_t frogger_get_draw_stats(frogger_t* game);
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "frustum.h"
+
+#include "simd.h"
+
+#include <math.h>
+
+static bool frustum_test_box(const frustum_t* frustum, const mat4f_t* m, const vec3f_t* extents);
+
+void frustum_from_matrix(frustum_t* frustum, const mat4f_t* view_projection)
+{
+	// Clip coordinate j of a point is its dot product with column j, so each plane
+	// combines the w column with the column it bounds.
+	const mat4f_t* m = view_projection;
+	for (int i = 0; i < 4; ++i)
+	{
+		frustum->planes[0][i] = m->data[i][3] + m->data[i][0];
+		frustum->planes[1][i] = m->data[i][3] - m->data[i][0];
+		frustum->planes[2][i] = m->data[i][3] + m->data[i][1];
+		frustum->planes[3][i] = m->data[i][3] - m->data[i][1];
+		frustum->planes[4][i] = m->data[i][2];
+		frustum->planes[5][i] = m->data[i][3] - m->data[i][2];
+	}
+}
+
+int frustum_cull_boxes(const frustum_t* frustum, const mat4f_t* matrices, const vec3f_t* extents, int count, bool* visible)
+{
+	int visible_count = 0;
+	int i = 0;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	simdf_t planes[6][4];
+	simdf_t abs_planes[6][3];
+	for (int p = 0; p < 6; ++p)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			planes[p][c] = simdf_set1(frustum->planes[p][c]);
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			abs_planes[p][c] = simdf_set1(fabsf(frustum->planes[p][c]));
+		}
+	}
+	simdf_t zero = simdf_set1(0.0f);
+
+	for (; i + k_simd_width <= count; i += k_simd_width)
+	{
+		// One vector per matrix element, lane j from matrices[i + j].
+		simdf_t m[4][4];
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				m[row][j] = simdf_load4(matrices[i + j].data[row], matrices[i + j + k_simd_width - 4].data[row]);
+			}
+			simdf_transpose4(&m[row][0], &m[row][1], &m[row][2], &m[row][3]);
+		}
+		float e[3][k_simd_width];
+		for (int j = 0; j < k_simd_width; ++j)
+		{
+			e[0][j] = extents[i + j].x;
+			e[1][j] = extents[i + j].y;
+			e[2][j] = extents[i + j].z;
+		}
+		simdf_t ex = simdf_load(e[0]);
+		simdf_t ey = simdf_load(e[1]);
+		simdf_t ez = simdf_load(e[2]);
+
+		// World space box around the translation, sized by the extents along each absolute axis.
+		simdf_t half[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			half[c] = simdf_mul(simdf_abs(m[0][c]), ex);
+			half[c] = simdf_add(half[c], simdf_mul(simdf_abs(m[1][c]), ey));
+			half[c] = simdf_add(half[c], simdf_mul(simdf_abs(m[2][c]), ez));
+		}
+
+		// Outside when even the corner furthest along the plane normal is behind it.
+		simdm_t outside = simdf_lt(zero, zero);
+		for (int p = 0; p < 6; ++p)
+		{
+			simdf_t d = simdf_add(simdf_mul(planes[p][0], m[3][0]), simdf_mul(planes[p][1], m[3][1]));
+			d = simdf_add(d, simdf_mul(planes[p][2], m[3][2]));
+			d = simdf_add(d, planes[p][3]);
+			simdf_t r = simdf_add(simdf_mul(abs_planes[p][0], half[0]), simdf_mul(abs_planes[p][1], half[1]));
+			r = simdf_add(r, simdf_mul(abs_planes[p][2], half[2]));
+			outside = simdm_or(outside, simdf_lt(simdf_add(d, r), zero));
+		}
+
+		uint32_t outside_bits = simdm_bits(outside);
+		for (int j = 0; j < k_simd_width; ++j)
+		{
+			visible[i + j] = (outside_bits & (1u << j)) == 0;
+			visible_count += visible[i + j];
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		visible[i] = frustum_test_box(frustum, &matrices[i], &extents[i]);
+		visible_count += visible[i];
+	}
+	return visible_count;
+}
+
+// Same arithmetic as the batch loop above, one box at a time.
+static bool frustum_test_box(const frustum_t* frustum, const mat4f_t* m, const vec3f_t* extents)
+{
+	float half[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		half[c] = fabsf(m->data[0][c]) * extents->x;
+		half[c] += fabsf(m->data[1][c]) * extents->y;
+		half[c] += fabsf(m->data[2][c]) * extents->z;
+	}
+
+	for (int p = 0; p < 6; ++p)
+	{
+		const float* plane = frustum->planes[p];
+		float d = plane[0] * m->data[3][0] + plane[1] * m->data[3][1];
+		d += plane[2] * m->data[3][2];
+		d += plane[3];
+		float r = fabsf(plane[0]) * half[0] + fabsf(plane[1]) * half[1];
+		r += fabsf(plane[2]) * half[2];
+		if (d + r < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
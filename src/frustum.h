@@ -0,0 +1,26 @@
+#pragma once
+
+// View frustum culling.
+// Tests object bounds against the volume a camera sees, so off-screen objects can be skipped.
+
+#include "mat4f.h"
+#include "vec3f.h"
+
+// Six planes bounding the volume a camera sees: left, right, bottom, top, near, far.
+// A point (x, y, z) is on the inside of plane p when p[0] * x + p[1] * y + p[2] * z + p[3] >= 0.
+// Planes are not normalized; tests only compare against zero.
+typedef struct frustum_t
+{
+	float planes[6][4];
+} frustum_t;
+
+// Extract the planes from a matrix taking world points to clip space, view * projection.
+// Clip space is the Vulkan one: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+void frustum_from_matrix(frustum_t* frustum, const mat4f_t* view_projection);
+
+// Test count boxes against the frustum, k_simd_width at a time (see simd.h).
+// Box i spans extents[i] either side of the origin, in the space that affine matrix matrices[i]
+// takes to world space. Sets visible[i] to false if the box is entirely outside a plane.
+// Conservative: boxes near a corner of the frustum may be kept even though they are outside.
+// Returns the number of visible boxes.
+int frustum_cull_boxes(const frustum_t* frustum, const mat4f_t* matrices, const vec3f_t* extents, int count, bool* visible);
@@ -1,6 +1,8 @@
 #include "debug.h"
+#include "ecs_bench.h"
 #include "fs.h"
 #include "heap.h"
+#include "math_bench.h"
 #include "render.h"
 #include "frogger_game.h"
 #include "timer.h"
@@ -8,6 +10,8 @@
 #include "controller.h"
 #include "input.h"
 
+#include <string.h>
+
 /*
 Set of pre-defined control schemes
 0: Keyboard: arrow keys
@@ -75,6 +79,25 @@ int main(int argc, const char* argv[])
 
 	heap_t* heap = heap_create(2 * 1024 * 1024);
 	fs_t* fs = fs_create(heap, 8);
+
+	// Headless benchmark mode: --bench-ecs [results.csv]
+	if (argc >= 2 && strcmp(argv[1], "--bench-ecs") == 0)
+	{
+		bool written = ecs_bench_run(heap, fs, argc >= 3 ? argv[2] : "ecs_bench.csv");
+		fs_destroy(fs);
+		heap_destroy(heap);
+		return written ? 0 : 1;
+	}
+
+	// Headless benchmark and accuracy mode: --bench-math [results.csv]
+	if (argc >= 2 && strcmp(argv[1], "--bench-math") == 0)
+	{
+		bool passed = math_bench_run(heap, fs, argc >= 3 ? argv[2] : "math_bench.csv");
+		fs_destroy(fs);
+		heap_destroy(heap);
+		return passed ? 0 : 1;
+	}
+
 	wm_window_t* window = wm_create(heap);
 	render_t* render = render_create(heap, window);
 	map_t* map = heap_alloc(heap, sizeof(map_t), 8);
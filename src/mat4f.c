@@ -3,10 +3,20 @@
 #include "quatf.h"
 #include "vec3f.h"
 
+#include "simd.h"
+
 #include <string.h>
 
 #include <xmmintrin.h>
 
+#if defined(SIMD_SSE2) || defined(SIMD_AVX2)
+#define MAT4F_SSE
+// Selects lanes x, y, z, w of v.
+#define MAT4F_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(w, z, y, x))
+// Selects lanes x and y of a followed by lanes z and w of b.
+#define MAT4F_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE(w, z, y, x))
+#endif
+
 void mat4f_make_identity(mat4f_t* m)
 {
 	memset(m, 0, sizeof(*m));
@@ -80,6 +90,45 @@ void mat4f_rotate(mat4f_t* m, const quatf_t* q)
 
 void mat4f_mul(mat4f_t* result, const mat4f_t* a, const mat4f_t* b)
 {
+#if defined(SIMD_AVX2)
+	// Two result rows per vector. Each row is a's row weighting the rows of b, summed in the
+	// same order as the scalar loop. All rows are computed before any is stored.
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)b->data[0]);
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)b->data[1]);
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)b->data[2]);
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)b->data[3]);
+	__m256 rows[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		__m256 a_rows = _mm256_loadu_ps(a->data[i * 2]);
+		__m256 row = _mm256_mul_ps(_mm256_permute_ps(a_rows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+		row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a_rows, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+		row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a_rows, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+		rows[i] = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a_rows, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+	}
+	_mm256_storeu_ps(result->data[0], rows[0]);
+	_mm256_storeu_ps(result->data[2], rows[1]);
+#elif defined(MAT4F_SSE)
+	// Each row is a's row weighting the rows of b, summed in the same order as the scalar loop.
+	// All rows are computed before any is stored.
+	__m128 b0 = _mm_loadu_ps(b->data[0]);
+	__m128 b1 = _mm_loadu_ps(b->data[1]);
+	__m128 b2 = _mm_loadu_ps(b->data[2]);
+	__m128 b3 = _mm_loadu_ps(b->data[3]);
+	__m128 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		__m128 a_row = _mm_loadu_ps(a->data[i]);
+		__m128 row = _mm_mul_ps(MAT4F_SWIZZLE(a_row, 0, 0, 0, 0), b0);
+		row = _mm_add_ps(row, _mm_mul_ps(MAT4F_SWIZZLE(a_row, 1, 1, 1, 1), b1));
+		row = _mm_add_ps(row, _mm_mul_ps(MAT4F_SWIZZLE(a_row, 2, 2, 2, 2), b2));
+		rows[i] = _mm_add_ps(row, _mm_mul_ps(MAT4F_SWIZZLE(a_row, 3, 3, 3, 3), b3));
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		_mm_storeu_ps(result->data[i], rows[i]);
+	}
+#else
 	for (int i = 0; i < 4; ++i)
 	{
 		for (int j = 0; j < 4; ++j)
@@ -92,6 +141,40 @@ void mat4f_mul(mat4f_t* result, const mat4f_t* a, const mat4f_t* b)
 			result->data[i][j] = tmp;
 		}
 	}
+#endif
+}
+
+void mat4f_mul_batch(mat4f_t* results, const mat4f_t* a, const mat4f_t* b, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		mat4f_mul(&results[i], &a[i], &b[i]);
+	}
+}
+
+void mat4f_transpose(mat4f_t* m)
+{
+#if defined(MAT4F_SSE)
+	__m128 row0 = _mm_loadu_ps(m->data[0]);
+	__m128 row1 = _mm_loadu_ps(m->data[1]);
+	__m128 row2 = _mm_loadu_ps(m->data[2]);
+	__m128 row3 = _mm_loadu_ps(m->data[3]);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	_mm_storeu_ps(m->data[0], row0);
+	_mm_storeu_ps(m->data[1], row1);
+	_mm_storeu_ps(m->data[2], row2);
+	_mm_storeu_ps(m->data[3], row3);
+#else
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = i + 1; j < 4; ++j)
+		{
+			float tmp = m->data[i][j];
+			m->data[i][j] = m->data[j][i];
+			m->data[j][i] = tmp;
+		}
+	}
+#endif
 }
 
 void mat4f_mul_inplace(mat4f_t* result, const mat4f_t* m)
@@ -135,8 +218,126 @@ void mat4f_transform_inplace(const mat4f_t* m, vec3f_t* v)
 	mat4f_transform(m, &tmp, v);
 }
 
+void mat4f_transform_points(const mat4f_t* m, const vec3f_t* in, vec3f_t* out, int count)
+{
+	int i = 0;
+#if defined(MAT4F_SSE)
+	__m128 m00 = _mm_set1_ps(m->data[0][0]), m01 = _mm_set1_ps(m->data[0][1]), m02 = _mm_set1_ps(m->data[0][2]);
+	__m128 m10 = _mm_set1_ps(m->data[1][0]), m11 = _mm_set1_ps(m->data[1][1]), m12 = _mm_set1_ps(m->data[1][2]);
+	__m128 m20 = _mm_set1_ps(m->data[2][0]), m21 = _mm_set1_ps(m->data[2][1]), m22 = _mm_set1_ps(m->data[2][2]);
+	__m128 m30 = _mm_set1_ps(m->data[3][0]), m31 = _mm_set1_ps(m->data[3][1]), m32 = _mm_set1_ps(m->data[3][2]);
+	for (; i + 4 <= count; i += 4)
+	{
+		// Four points are twelve floats: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+		const float* source = in[i].a;
+		__m128 a = _mm_loadu_ps(source);
+		__m128 b = _mm_loadu_ps(source + 4);
+		__m128 c = _mm_loadu_ps(source + 8);
+		__m128 x = MAT4F_SHUFFLE(a, MAT4F_SHUFFLE(b, c, 2, 2, 1, 1), 0, 3, 0, 2);
+		__m128 y = MAT4F_SHUFFLE(MAT4F_SHUFFLE(a, b, 1, 1, 0, 0), MAT4F_SHUFFLE(b, c, 3, 3, 2, 2), 0, 2, 0, 2);
+		__m128 z = MAT4F_SHUFFLE(MAT4F_SHUFFLE(a, b, 2, 2, 1, 1), MAT4F_SWIZZLE(c, 0, 0, 3, 3), 0, 2, 0, 2);
+
+		// Same order of operations as mat4f_transform().
+		__m128 out_x = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_mul_ps(z, m20)), m30);
+		__m128 out_y = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_mul_ps(z, m21)), m31);
+		__m128 out_z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_mul_ps(z, m22)), m32);
+
+		__m128 xy01 = _mm_unpacklo_ps(out_x, out_y);
+		__m128 xy23 = _mm_unpackhi_ps(out_x, out_y);
+		float* dest = out[i].a;
+		_mm_storeu_ps(dest, MAT4F_SHUFFLE(xy01, MAT4F_SHUFFLE(out_z, xy01, 0, 0, 2, 2), 0, 1, 0, 2));
+		_mm_storeu_ps(dest + 4, MAT4F_SHUFFLE(MAT4F_SHUFFLE(xy01, out_z, 3, 3, 1, 1), xy23, 0, 2, 0, 1));
+		_mm_storeu_ps(dest + 8, MAT4F_SHUFFLE(MAT4F_SHUFFLE(out_z, xy23, 2, 2, 2, 2), MAT4F_SHUFFLE(xy23, out_z, 3, 3, 3, 3), 0, 2, 0, 2));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		vec3f_t tmp = in[i];
+		mat4f_transform(m, &tmp, &out[i]);
+	}
+}
+
+#if defined(MAT4F_SSE)
+// 2x2 matrices are held row-major in one vector: a b / c d as (a, b, c, d).
+// Returns a * b.
+static __m128 mat2f_mul(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, MAT4F_SWIZZLE(b, 0, 3, 0, 3)),
+		_mm_mul_ps(MAT4F_SWIZZLE(a, 1, 0, 3, 2), MAT4F_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Returns adjugate(a) * b.
+static __m128 mat2f_adj_mul(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(MAT4F_SWIZZLE(a, 3, 3, 0, 0), b),
+		_mm_mul_ps(MAT4F_SWIZZLE(a, 1, 1, 2, 2), MAT4F_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// Returns a * adjugate(b).
+static __m128 mat2f_mul_adj(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, MAT4F_SWIZZLE(b, 3, 0, 3, 0)),
+		_mm_mul_ps(MAT4F_SWIZZLE(a, 1, 0, 3, 2), MAT4F_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Invert by 2x2 blocks: with M = [A B; C D], the blocks of the inverse are built from the
+// blocks' adjugates and determinants without any division but the final one by |M|.
+static bool mat4f_invert_simd(mat4f_t* m)
+{
+	__m128 row0 = _mm_loadu_ps(m->data[0]);
+	__m128 row1 = _mm_loadu_ps(m->data[1]);
+	__m128 row2 = _mm_loadu_ps(m->data[2]);
+	__m128 row3 = _mm_loadu_ps(m->data[3]);
+	__m128 a = _mm_movelh_ps(row0, row1);
+	__m128 b = _mm_movehl_ps(row1, row0);
+	__m128 c = _mm_movelh_ps(row2, row3);
+	__m128 d = _mm_movehl_ps(row3, row2);
+
+	// (|A|, |B|, |C|, |D|)
+	__m128 det_sub = _mm_sub_ps(
+		_mm_mul_ps(MAT4F_SHUFFLE(row0, row2, 0, 2, 0, 2), MAT4F_SHUFFLE(row1, row3, 1, 3, 1, 3)),
+		_mm_mul_ps(MAT4F_SHUFFLE(row0, row2, 1, 3, 1, 3), MAT4F_SHUFFLE(row1, row3, 0, 2, 0, 2)));
+	__m128 det_a = MAT4F_SWIZZLE(det_sub, 0, 0, 0, 0);
+	__m128 det_b = MAT4F_SWIZZLE(det_sub, 1, 1, 1, 1);
+	__m128 det_c = MAT4F_SWIZZLE(det_sub, 2, 2, 2, 2);
+	__m128 det_d = MAT4F_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+	__m128 d_c = mat2f_adj_mul(d, c);
+	__m128 a_b = mat2f_adj_mul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), mat2f_mul(b, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), mat2f_mul(c, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), mat2f_mul_adj(d, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), mat2f_mul_adj(a, d_c));
+
+	// |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C)
+	__m128 trace = _mm_mul_ps(a_b, MAT4F_SWIZZLE(d_c, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, MAT4F_SWIZZLE(trace, 2, 3, 0, 1));
+	trace = _mm_add_ps(trace, MAT4F_SWIZZLE(trace, 1, 0, 3, 2));
+	__m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+	if (_mm_cvtss_f32(det) == 0.0f)
+	{
+		return false;
+	}
+
+	// The blocks above are adjugates; the sign pattern and the shuffles below finish them.
+	__m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inv_det);
+	y = _mm_mul_ps(y, inv_det);
+	z = _mm_mul_ps(z, inv_det);
+	w = _mm_mul_ps(w, inv_det);
+	_mm_storeu_ps(m->data[0], MAT4F_SHUFFLE(x, y, 3, 1, 3, 1));
+	_mm_storeu_ps(m->data[1], MAT4F_SHUFFLE(x, y, 2, 0, 2, 0));
+	_mm_storeu_ps(m->data[2], MAT4F_SHUFFLE(z, w, 3, 1, 3, 1));
+	_mm_storeu_ps(m->data[3], MAT4F_SHUFFLE(z, w, 2, 0, 2, 0));
+	return true;
+}
+#endif
+
 bool mat4f_invert(mat4f_t* m)
 {
+#if defined(MAT4F_SSE)
+	return mat4f_invert_simd(m);
+#else
 	float s[6];
 	s[0] = m->data[0][0] * m->data[1][1] - m->data[1][0] * m->data[0][1];
 	s[1] = m->data[0][0] * m->data[1][2] - m->data[1][0] * m->data[0][2];
@@ -183,6 +384,7 @@ bool mat4f_invert(mat4f_t* m)
 
 	*m = tmp;
 	return true;
+#endif
 }
 
 void mat4f_make_perspective(mat4f_t* m, float angle, float aspect, float z_near, float z_far)
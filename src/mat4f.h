@@ -41,12 +41,22 @@ void mat4f_mul(mat4f_t* result, const mat4f_t* a, const mat4f_t* b);
 // Concatenate matrices result and m and store in result.
 void mat4f_mul_inplace(mat4f_t* result, const mat4f_t* m);
 
+// Concatenate count pairs of matrices: results[i] = a[i] * b[i].
+void mat4f_mul_batch(mat4f_t* results, const mat4f_t* a, const mat4f_t* b, int count);
+
+// Swap the rows and columns of matrix m.
+void mat4f_transpose(mat4f_t* m);
+
 // Multiples vector in by matrix m and stores the result in out.
 void mat4f_transform(const mat4f_t* m, const vec3f_t* in, vec3f_t* out);
 
 // Multiples vector v by matrix m and stores the result back in v.
 void mat4f_transform_inplace(const mat4f_t* m, vec3f_t* v);
 
+// Multiplies count points by matrix m, four at a time with SIMD.
+// Same results as mat4f_transform() on each. out may be the same array as in.
+void mat4f_transform_points(const mat4f_t* m, const vec3f_t* in, vec3f_t* out, int count);
+
 // Attempt to compute a matrix inverse.
 // Returns true on success, returns false if the determinant is zero.
 bool mat4f_invert(mat4f_t* m);
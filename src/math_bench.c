@@ -0,0 +1,1240 @@
+#include "math_bench.h"
+
+#include "debug.h"
+#include "fs.h"
+#include "heap.h"
+#include "mat4f.h"
+#include "quatf.h"
+#include "timer.h"
+#include "transform.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+enum
+{
+	k_bench_count = 1024,
+	k_bench_repeat = 16,
+	// Most floats in one result: a matrix.
+	k_bench_max_floats = 16,
+	// Counts checked for the batch transform routines: two batches of the widest SIMD and a remainder.
+	k_bench_tail_count = 17,
+};
+
+// CSV text of the results so far.
+typedef struct bench_results_t
+{
+	heap_t* heap;
+	char* text;
+	size_t size;
+	size_t capacity;
+	bool passed;
+} bench_results_t;
+
+// Where a case writes its k_bench_count results.
+typedef enum bench_output_t
+{
+	k_output_float,
+	k_output_vec3f,
+	k_output_quatf,
+	k_output_mat4f,
+	k_output_transform,
+	k_output_vec3f_soa,
+	k_output_quatf_soa,
+} bench_output_t;
+
+// Inputs and outputs for one pass over k_bench_count elements.
+// Batch routines read the component arrays, single element ones the structures holding the same values.
+typedef struct bench_data_t
+{
+	mat4f_t* matrices_a;
+	mat4f_t* matrices_b;
+	transform_t* transforms;
+	transform_soa_t transforms_soa;
+	quatf_t* quats_a;
+	quatf_t* quats_b;
+	quatf_soa_t quats_a_soa;
+	quatf_soa_t quats_b_soa;
+	vec3f_t* vectors_a;
+	vec3f_t* vectors_b;
+	vec3f_soa_t vectors_a_soa;
+	vec3f_t* eulers;
+	vec3f_soa_t eulers_soa;
+	float* t;
+
+	float* floats_out;
+	vec3f_t* vectors_out;
+	quatf_t* quats_out;
+	mat4f_t* matrices_out;
+	transform_t* transforms_out;
+	vec3f_soa_t vectors_out_soa;
+	quatf_soa_t quats_out_soa;
+} bench_data_t;
+
+typedef void (*bench_pass_t)(bench_data_t* data);
+
+// Computes result index of a case in double precision.
+// Returns the magnitude errors are measured against, or zero for the largest element of the result.
+typedef double (*bench_reference_t)(const bench_data_t* data, int index, double* out);
+
+// One timed and checked routine.
+typedef struct bench_case_t
+{
+	const char* suite;
+	const char* variant;
+	bench_pass_t pass;
+	bench_output_t output;
+	bench_reference_t reference;
+	// Largest allowed difference from the double precision reference.
+	float reference_ulp;
+	// Whether the case is a faster version of the one before it, and how far their results may differ.
+	bool versus_previous;
+	float previous_ulp;
+} bench_case_t;
+
+// Keeps benchmark results from being optimized away.
+static volatile float s_bench_sink;
+
+static double ticks_to_ns(uint64_t ticks)
+{
+	return (double)ticks * 1000000000.0 / (double)timer_get_ticks_per_second();
+}
+
+static void results_append(bench_results_t* results, const char* text, size_t size)
+{
+	if (results->size + size + 1 > results->capacity)
+	{
+		size_t new_capacity = __max(results->capacity * 2, results->size + size + 1);
+		char* new_text = heap_alloc(results->heap, new_capacity, 8);
+		if (results->text)
+		{
+			memcpy(new_text, results->text, results->size);
+			heap_free(results->heap, results->text);
+		}
+		results->text = new_text;
+		results->capacity = new_capacity;
+	}
+	memcpy(results->text + results->size, text, size);
+	results->size += size;
+	results->text[results->size] = '\0';
+}
+
+// Add a row, failing the run if either error exceeds its tolerance.
+static void results_add(bench_results_t* results, const bench_case_t* c, uint64_t ticks, float previous_ulp, float reference_ulp)
+{
+	double ns = ticks_to_ns(ticks);
+	char row[256];
+	int length = sprintf_s(row, sizeof(row), "%s,%s,%d,%d,%.0f,%.3f,%.1f,%.1f\n",
+		c->suite, c->variant, k_bench_count, k_bench_count, ns, ns / k_bench_count, previous_ulp, reference_ulp);
+	if (length > 0)
+	{
+		results_append(results, row, length);
+		debug_print(k_print_info, "math_bench %s", row);
+	}
+	if (!(previous_ulp <= c->previous_ulp))
+	{
+		debug_print(k_print_error, "math_bench %s %s is off by %.1f ulp from the version before it, more than %.1f\n", c->suite, c->variant, previous_ulp, c->previous_ulp);
+		results->passed = false;
+	}
+	if (!(reference_ulp <= c->reference_ulp))
+	{
+		debug_print(k_print_error, "math_bench %s %s is off by %.1f ulp from the reference, more than %.1f\n", c->suite, c->variant, reference_ulp, c->reference_ulp);
+		results->passed = false;
+	}
+}
+
+// Uniform in [-range, range], from a fixed sequence so runs are comparable.
+static float bench_random(uint32_t* seed, float range)
+{
+	*seed = *seed * 1664525 + 1013904223;
+	return ((float)(*seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f) * range;
+}
+
+static vec3f_t random_vec3f(uint32_t* seed, float range)
+{
+	return (vec3f_t){ .x = bench_random(seed, range), .y = bench_random(seed, range), .z = bench_random(seed, range) };
+}
+
+// A transform with unit rotation and scale between 0.5 and 2, so its matrix is well conditioned.
+static void random_transform(uint32_t* seed, transform_t* t)
+{
+	t->translation = random_vec3f(seed, 10.0f);
+	t->scale = (vec3f_t){ .x = 1.25f + bench_random(seed, 0.75f), .y = 1.25f + bench_random(seed, 0.75f), .z = 1.25f + bench_random(seed, 0.75f) };
+	quatf_t q = { .x = bench_random(seed, 1.0f), .y = bench_random(seed, 1.0f), .z = bench_random(seed, 1.0f), .w = bench_random(seed, 1.0f) };
+	float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	t->rotation = (quatf_t){ .x = q.x / length, .y = q.y / length, .z = q.z / length, .w = q.w / length };
+}
+
+static float float_ulp(float magnitude)
+{
+	return magnitude > 0.0f ? nextafterf(magnitude, INFINITY) - magnitude : FLT_MIN;
+}
+
+// Largest difference between count floats, in units of the last place of the largest expected value.
+// Measuring against the largest value keeps cancellation in small elements from dominating.
+static float ulp_error(const float* actual, const float* expected, int count)
+{
+	float magnitude = 0.0f;
+	float error = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		magnitude = __max(magnitude, fabsf(expected[i]));
+		error = __max(error, fabsf(actual[i] - expected[i]));
+	}
+	return error / float_ulp(magnitude);
+}
+
+// As ulp_error(), against a double precision result, still in float ulps.
+// A nonzero magnitude replaces the largest expected value.
+static float reference_ulp_error(const float* actual, const double* expected, int count, double magnitude)
+{
+	bool use_largest = magnitude == 0.0;
+	double error = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		magnitude = use_largest ? __max(magnitude, fabs(expected[i])) : magnitude;
+		error = __max(error, fabs(actual[i] - expected[i]));
+	}
+	return (float)(error / float_ulp((float)magnitude));
+}
+
+// Copy result index of a case into out, returning the number of floats.
+static int read_output(const bench_data_t* data, bench_output_t output, int index, float* out)
+{
+	switch (output)
+	{
+	case k_output_float:
+		out[0] = data->floats_out[index];
+		return 1;
+	case k_output_vec3f:
+		memcpy(out, &data->vectors_out[index], sizeof(float) * 3);
+		return 3;
+	case k_output_quatf:
+		memcpy(out, &data->quats_out[index], sizeof(float) * 4);
+		return 4;
+	case k_output_mat4f:
+		memcpy(out, &data->matrices_out[index], sizeof(float) * 16);
+		return 16;
+	case k_output_transform:
+		memcpy(out, &data->transforms_out[index], sizeof(float) * 10);
+		return 10;
+	case k_output_vec3f_soa:
+		out[0] = data->vectors_out_soa.x[index];
+		out[1] = data->vectors_out_soa.y[index];
+		out[2] = data->vectors_out_soa.z[index];
+		return 3;
+	case k_output_quatf_soa:
+		out[0] = data->quats_out_soa.x[index];
+		out[1] = data->quats_out_soa.y[index];
+		out[2] = data->quats_out_soa.z[index];
+		out[3] = data->quats_out_soa.w[index];
+		return 4;
+	}
+	return 0;
+}
+
+// Best time of several runs of a pass.
+static uint64_t time_pass(bench_pass_t pass, bench_data_t* data, bench_output_t output)
+{
+	uint64_t best = UINT64_MAX;
+	for (int r = 0; r < k_bench_repeat; ++r)
+	{
+		uint64_t start = timer_get_ticks();
+		pass(data);
+		best = __min(best, timer_get_ticks() - start);
+	}
+	float first[k_bench_max_floats];
+	read_output(data, output, 0, first);
+	s_bench_sink = first[0];
+	return best;
+}
+
+// Double precision building blocks for the references.
+
+static void quat_to_double(const quatf_t* q, double* out)
+{
+	out[0] = q->x;
+	out[1] = q->y;
+	out[2] = q->z;
+	out[3] = q->w;
+}
+
+static void quat_mul_double(const double* a, const double* b, double* out)
+{
+	double r[4];
+	r[0] = a[1] * b[2] - a[2] * b[1] + b[0] * a[3] + a[0] * b[3];
+	r[1] = a[2] * b[0] - a[0] * b[2] + b[1] * a[3] + a[1] * b[3];
+	r[2] = a[0] * b[1] - a[1] * b[0] + b[2] * a[3] + a[2] * b[3];
+	r[3] = a[3] * b[3] - (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+	memcpy(out, r, sizeof(r));
+}
+
+static void quat_rotate_double(const double* q, const double* v, double* out)
+{
+	double t[3] =
+	{
+		2.0 * (q[1] * v[2] - q[2] * v[1]),
+		2.0 * (q[2] * v[0] - q[0] * v[2]),
+		2.0 * (q[0] * v[1] - q[1] * v[0]),
+	};
+	double r[3];
+	r[0] = v[0] + t[0] * q[3] + (q[1] * t[2] - q[2] * t[1]);
+	r[1] = v[1] + t[1] * q[3] + (q[2] * t[0] - q[0] * t[2]);
+	r[2] = v[2] + t[2] * q[3] + (q[0] * t[1] - q[1] * t[0]);
+	memcpy(out, r, sizeof(r));
+}
+
+// Rotation part of a matrix, as mat4f_make_rotation() lays it out.
+static void quat_to_rotation_double(const double* q, double r[3][3])
+{
+	r[0][0] = 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]);
+	r[1][0] = 2.0 * (q[0] * q[1] - q[2] * q[3]);
+	r[2][0] = 2.0 * (q[0] * q[2] + q[1] * q[3]);
+	r[0][1] = 2.0 * (q[0] * q[1] + q[2] * q[3]);
+	r[1][1] = 1.0 - 2.0 * (q[0] * q[0] + q[2] * q[2]);
+	r[2][1] = 2.0 * (q[1] * q[2] - q[0] * q[3]);
+	r[0][2] = 2.0 * (q[0] * q[2] - q[1] * q[3]);
+	r[1][2] = 2.0 * (q[1] * q[2] + q[0] * q[3]);
+	r[2][2] = 1.0 - 2.0 * (q[0] * q[0] + q[1] * q[1]);
+}
+
+// Gauss-Jordan elimination with partial pivoting.
+static void mat_invert_double(const mat4f_t* m, double* out)
+{
+	double a[4][8];
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			a[i][j] = m->data[i][j];
+			a[i][j + 4] = i == j ? 1.0 : 0.0;
+		}
+	}
+	for (int col = 0; col < 4; ++col)
+	{
+		int pivot = col;
+		for (int row = col + 1; row < 4; ++row)
+		{
+			if (fabs(a[row][col]) > fabs(a[pivot][col]))
+			{
+				pivot = row;
+			}
+		}
+		for (int j = 0; j < 8; ++j)
+		{
+			double tmp = a[col][j];
+			a[col][j] = a[pivot][j];
+			a[pivot][j] = tmp;
+		}
+		double inv = 1.0 / a[col][col];
+		for (int j = 0; j < 8; ++j)
+		{
+			a[col][j] *= inv;
+		}
+		for (int row = 0; row < 4; ++row)
+		{
+			if (row != col)
+			{
+				double f = a[row][col];
+				for (int j = 0; j < 8; ++j)
+				{
+					a[row][j] -= f * a[col][j];
+				}
+			}
+		}
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			out[i * 4 + j] = a[i][j + 4];
+		}
+	}
+}
+
+// vec3f
+
+static double length_double(const vec3f_t* v)
+{
+	return sqrt((double)v->x * v->x + (double)v->y * v->y + (double)v->z * v->z);
+}
+
+static void pass_vec3f_add(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = vec3f_add(data->vectors_a[i], data->vectors_b[i]);
+	}
+}
+
+static double reference_vec3f_add(const bench_data_t* data, int index, double* out)
+{
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] = (double)data->vectors_a[index].a[c] + data->vectors_b[index].a[c];
+	}
+	return 0.0;
+}
+
+static void pass_vec3f_cross(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = vec3f_cross(data->vectors_a[i], data->vectors_b[i]);
+	}
+}
+
+static double reference_vec3f_cross(const bench_data_t* data, int index, double* out)
+{
+	const vec3f_t* a = &data->vectors_a[index];
+	const vec3f_t* b = &data->vectors_b[index];
+	out[0] = (double)a->y * b->z - (double)a->z * b->y;
+	out[1] = (double)a->z * b->x - (double)a->x * b->z;
+	out[2] = (double)a->x * b->y - (double)a->y * b->x;
+	// Components can cancel to nothing; measure against the size of the products instead.
+	return length_double(a) * length_double(b);
+}
+
+static void pass_vec3f_dot(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->floats_out[i] = vec3f_dot(data->vectors_a[i], data->vectors_b[i]);
+	}
+}
+
+static double reference_vec3f_dot(const bench_data_t* data, int index, double* out)
+{
+	const vec3f_t* a = &data->vectors_a[index];
+	const vec3f_t* b = &data->vectors_b[index];
+	out[0] = (double)a->x * b->x + (double)a->y * b->y + (double)a->z * b->z;
+	return length_double(a) * length_double(b);
+}
+
+static void pass_vec3f_mag(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->floats_out[i] = vec3f_mag(data->vectors_a[i]);
+	}
+}
+
+static double reference_vec3f_mag(const bench_data_t* data, int index, double* out)
+{
+	out[0] = length_double(&data->vectors_a[index]);
+	return 0.0;
+}
+
+static void pass_vec3f_norm(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = vec3f_norm(data->vectors_a[i]);
+	}
+}
+
+static double reference_vec3f_norm(const bench_data_t* data, int index, double* out)
+{
+	double length = length_double(&data->vectors_a[index]);
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] = data->vectors_a[index].a[c] / length;
+	}
+	return 0.0;
+}
+
+static void pass_vec3f_lerp(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = vec3f_lerp(data->vectors_a[i], data->vectors_b[i], data->t[i]);
+	}
+}
+
+static double reference_vec3f_lerp(const bench_data_t* data, int index, double* out)
+{
+	double t = data->t[index];
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] = data->vectors_a[index].a[c] * (1.0 - t) + data->vectors_b[index].a[c] * t;
+	}
+	return 0.0;
+}
+
+// mat4f
+
+// The multiply, transpose and inverse mat4f.c used before it had SIMD paths.
+
+static void mat4f_mul_scalar(mat4f_t* result, const mat4f_t* a, const mat4f_t* b)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			float tmp = 0.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				tmp += a->data[i][k] * b->data[k][j];
+			}
+			result->data[i][j] = tmp;
+		}
+	}
+}
+
+static void mat4f_transpose_scalar(mat4f_t* m)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = i + 1; j < 4; ++j)
+		{
+			float tmp = m->data[i][j];
+			m->data[i][j] = m->data[j][i];
+			m->data[j][i] = tmp;
+		}
+	}
+}
+
+static bool mat4f_invert_scalar(mat4f_t* m)
+{
+	float s[6];
+	s[0] = m->data[0][0] * m->data[1][1] - m->data[1][0] * m->data[0][1];
+	s[1] = m->data[0][0] * m->data[1][2] - m->data[1][0] * m->data[0][2];
+	s[2] = m->data[0][0] * m->data[1][3] - m->data[1][0] * m->data[0][3];
+	s[3] = m->data[0][1] * m->data[1][2] - m->data[1][1] * m->data[0][2];
+	s[4] = m->data[0][1] * m->data[1][3] - m->data[1][1] * m->data[0][3];
+	s[5] = m->data[0][2] * m->data[1][3] - m->data[1][2] * m->data[0][3];
+
+	float c[6];
+	c[0] = m->data[2][0] * m->data[3][1] - m->data[3][0] * m->data[2][1];
+	c[1] = m->data[2][0] * m->data[3][2] - m->data[3][0] * m->data[2][2];
+	c[2] = m->data[2][0] * m->data[3][3] - m->data[3][0] * m->data[2][3];
+	c[3] = m->data[2][1] * m->data[3][2] - m->data[3][1] * m->data[2][2];
+	c[4] = m->data[2][1] * m->data[3][3] - m->data[3][1] * m->data[2][3];
+	c[5] = m->data[2][2] * m->data[3][3] - m->data[3][2] * m->data[2][3];
+
+	float det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+	if (det == 0.0f)
+	{
+		return false;
+	}
+	float inv_det = 1.0f / det;
+
+	mat4f_t tmp;
+	tmp.data[0][0] = (m->data[1][1] * c[5] - m->data[1][2] * c[4] + m->data[1][3] * c[3]) * inv_det;
+	tmp.data[0][1] = (-m->data[0][1] * c[5] + m->data[0][2] * c[4] - m->data[0][3] * c[3]) * inv_det;
+	tmp.data[0][2] = (m->data[3][1] * s[5] - m->data[3][2] * s[4] + m->data[3][3] * s[3]) * inv_det;
+	tmp.data[0][3] = (-m->data[2][1] * s[5] + m->data[2][2] * s[4] - m->data[2][3] * s[3]) * inv_det;
+
+	tmp.data[1][0] = (-m->data[1][0] * c[5] + m->data[1][2] * c[2] - m->data[1][3] * c[1]) * inv_det;
+	tmp.data[1][1] = (m->data[0][0] * c[5] - m->data[0][2] * c[2] + m->data[0][3] * c[1]) * inv_det;
+	tmp.data[1][2] = (-m->data[3][0] * s[5] + m->data[3][2] * s[2] - m->data[3][3] * s[1]) * inv_det;
+	tmp.data[1][3] = (m->data[2][0] * s[5] - m->data[2][2] * s[2] + m->data[2][3] * s[1]) * inv_det;
+
+	tmp.data[2][0] = (m->data[1][0] * c[4] - m->data[1][1] * c[2] + m->data[1][3] * c[0]) * inv_det;
+	tmp.data[2][1] = (-m->data[0][0] * c[4] + m->data[0][1] * c[2] - m->data[0][3] * c[0]) * inv_det;
+	tmp.data[2][2] = (m->data[3][0] * s[4] - m->data[3][1] * s[2] + m->data[3][3] * s[0]) * inv_det;
+	tmp.data[2][3] = (-m->data[2][0] * s[4] + m->data[2][1] * s[2] - m->data[2][3] * s[0]) * inv_det;
+
+	tmp.data[3][0] = (-m->data[1][0] * c[3] + m->data[1][1] * c[1] - m->data[1][2] * c[0]) * inv_det;
+	tmp.data[3][1] = (m->data[0][0] * c[3] - m->data[0][1] * c[1] + m->data[0][2] * c[0]) * inv_det;
+	tmp.data[3][2] = (-m->data[3][0] * s[3] + m->data[3][1] * s[1] - m->data[3][2] * s[0]) * inv_det;
+	tmp.data[3][3] = (m->data[2][0] * s[3] - m->data[2][1] * s[1] + m->data[2][2] * s[0]) * inv_det;
+
+	*m = tmp;
+	return true;
+}
+
+static void pass_mat4f_mul_scalar(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_mul_scalar(&data->matrices_out[i], &data->matrices_a[i], &data->matrices_b[i]);
+	}
+}
+
+static void pass_mat4f_mul(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_mul(&data->matrices_out[i], &data->matrices_a[i], &data->matrices_b[i]);
+	}
+}
+
+static void pass_mat4f_mul_batch(bench_data_t* data)
+{
+	mat4f_mul_batch(data->matrices_out, data->matrices_a, data->matrices_b, k_bench_count);
+}
+
+static double reference_mat4f_mul(const bench_data_t* data, int index, double* out)
+{
+	const mat4f_t* a = &data->matrices_a[index];
+	const mat4f_t* b = &data->matrices_b[index];
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			double sum = 0.0;
+			for (int k = 0; k < 4; ++k)
+			{
+				sum += (double)a->data[i][k] * b->data[k][j];
+			}
+			out[i * 4 + j] = sum;
+		}
+	}
+	return 0.0;
+}
+
+static void pass_mat4f_invert_scalar(bench_data_t* data)
+{
+	memcpy(data->matrices_out, data->matrices_a, sizeof(mat4f_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_invert_scalar(&data->matrices_out[i]);
+	}
+}
+
+static void pass_mat4f_invert(bench_data_t* data)
+{
+	memcpy(data->matrices_out, data->matrices_a, sizeof(mat4f_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_invert(&data->matrices_out[i]);
+	}
+}
+
+static double reference_mat4f_invert(const bench_data_t* data, int index, double* out)
+{
+	mat_invert_double(&data->matrices_a[index], out);
+	return 0.0;
+}
+
+static void pass_mat4f_transpose_scalar(bench_data_t* data)
+{
+	memcpy(data->matrices_out, data->matrices_a, sizeof(mat4f_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_transpose_scalar(&data->matrices_out[i]);
+	}
+}
+
+static void pass_mat4f_transpose(bench_data_t* data)
+{
+	memcpy(data->matrices_out, data->matrices_a, sizeof(mat4f_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_transpose(&data->matrices_out[i]);
+	}
+}
+
+static double reference_mat4f_transpose(const bench_data_t* data, int index, double* out)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			out[i * 4 + j] = data->matrices_a[index].data[j][i];
+		}
+	}
+	return 0.0;
+}
+
+static void pass_mat4f_transform(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_transform(&data->matrices_a[0], &data->vectors_a[i], &data->vectors_out[i]);
+	}
+}
+
+static void pass_mat4f_transform_points(bench_data_t* data)
+{
+	mat4f_transform_points(&data->matrices_a[0], data->vectors_a, data->vectors_out, k_bench_count);
+}
+
+static double reference_mat4f_transform(const bench_data_t* data, int index, double* out)
+{
+	const mat4f_t* m = &data->matrices_a[0];
+	const vec3f_t* v = &data->vectors_a[index];
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] = (double)v->x * m->data[0][c] + (double)v->y * m->data[1][c] + (double)v->z * m->data[2][c] + m->data[3][c];
+	}
+	return 0.0;
+}
+
+static void pass_mat4f_make_rotation(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		mat4f_make_rotation(&data->matrices_out[i], &data->quats_a[i]);
+	}
+}
+
+static double reference_mat4f_make_rotation(const bench_data_t* data, int index, double* out)
+{
+	double q[4];
+	double r[3][3];
+	quat_to_double(&data->quats_a[index], q);
+	quat_to_rotation_double(q, r);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			out[i * 4 + j] = i < 3 && j < 3 ? r[i][j] : (i == j ? 1.0 : 0.0);
+		}
+	}
+	return 0.0;
+}
+
+// quatf
+
+static void pass_quatf_mul(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->quats_out[i] = quatf_mul(data->quats_a[i], data->quats_b[i]);
+	}
+}
+
+static void pass_quatf_mul_batch(bench_data_t* data)
+{
+	quatf_mul_batch(&data->quats_out_soa, &data->quats_a_soa, &data->quats_b_soa, k_bench_count);
+}
+
+static double reference_quatf_mul(const bench_data_t* data, int index, double* out)
+{
+	double a[4];
+	double b[4];
+	quat_to_double(&data->quats_a[index], a);
+	quat_to_double(&data->quats_b[index], b);
+	quat_mul_double(a, b, out);
+	return 0.0;
+}
+
+static void pass_quatf_rotate_vec(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = quatf_rotate_vec(data->quats_a[i], data->vectors_a[i]);
+	}
+}
+
+static void pass_quatf_rotate_vec_batch(bench_data_t* data)
+{
+	quatf_rotate_vec_batch(&data->vectors_out_soa, &data->quats_a_soa, &data->vectors_a_soa, k_bench_count);
+}
+
+static double reference_quatf_rotate_vec(const bench_data_t* data, int index, double* out)
+{
+	double q[4];
+	double v[3] = { data->vectors_a[index].x, data->vectors_a[index].y, data->vectors_a[index].z };
+	quat_to_double(&data->quats_a[index], q);
+	quat_rotate_double(q, v, out);
+	return 0.0;
+}
+
+static void pass_quatf_nlerp(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->quats_out[i] = quatf_nlerp(data->quats_a[i], data->quats_b[i], data->t[i]);
+	}
+}
+
+static void pass_quatf_nlerp_batch(bench_data_t* data)
+{
+	quatf_nlerp_batch(&data->quats_out_soa, &data->quats_a_soa, &data->quats_b_soa, data->t, k_bench_count);
+}
+
+static double reference_quatf_nlerp(const bench_data_t* data, int index, double* out)
+{
+	double a[4];
+	double b[4];
+	quat_to_double(&data->quats_a[index], a);
+	quat_to_double(&data->quats_b[index], b);
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	double t = data->t[index];
+	double tb = d < 0.0 ? -t : t;
+	double length = 0.0;
+	for (int c = 0; c < 4; ++c)
+	{
+		out[c] = a[c] * (1.0 - t) + b[c] * tb;
+		length += out[c] * out[c];
+	}
+	length = sqrt(length);
+	for (int c = 0; c < 4; ++c)
+	{
+		out[c] /= length;
+	}
+	return 0.0;
+}
+
+static void pass_quatf_slerp(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->quats_out[i] = quatf_slerp(data->quats_a[i], data->quats_b[i], data->t[i]);
+	}
+}
+
+static void pass_quatf_slerp_batch(bench_data_t* data)
+{
+	quatf_slerp_batch(&data->quats_out_soa, &data->quats_a_soa, &data->quats_b_soa, data->t, k_bench_count);
+}
+
+static double reference_quatf_slerp(const bench_data_t* data, int index, double* out)
+{
+	double a[4];
+	double b[4];
+	quat_to_double(&data->quats_a[index], a);
+	quat_to_double(&data->quats_b[index], b);
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	double sign = d < 0.0 ? -1.0 : 1.0;
+	double theta = acos(__min(fabs(d), 1.0));
+	double t = data->t[index];
+	double ta = theta > 0.0 ? sin((1.0 - t) * theta) / sin(theta) : 1.0 - t;
+	double tb = theta > 0.0 ? sin(t * theta) / sin(theta) : t;
+	for (int c = 0; c < 4; ++c)
+	{
+		out[c] = a[c] * ta + b[c] * sign * tb;
+	}
+	return 0.0;
+}
+
+static void pass_quatf_to_eulers(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = quatf_to_eulers(data->quats_a[i]);
+	}
+}
+
+static void pass_quatf_to_eulers_batch(bench_data_t* data)
+{
+	quatf_to_eulers_batch(&data->vectors_out_soa, &data->quats_a_soa, k_bench_count);
+}
+
+static double reference_quatf_to_eulers(const bench_data_t* data, int index, double* out)
+{
+	double q[4];
+	quat_to_double(&data->quats_a[index], q);
+	double sinp = 2.0 * (q[3] * q[1] - q[2] * q[0]);
+	out[0] = atan2(2.0 * (q[3] * q[0] + q[1] * q[2]), 1.0 - 2.0 * (q[0] * q[0] + q[1] * q[1]));
+	out[1] = asin(__max(-1.0, __min(1.0, sinp)));
+	out[2] = atan2(2.0 * (q[3] * q[2] + q[0] * q[1]), 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]));
+	return 0.0;
+}
+
+static void pass_quatf_from_eulers(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->quats_out[i] = quatf_from_eulers(data->eulers[i]);
+	}
+}
+
+static void pass_quatf_from_eulers_batch(bench_data_t* data)
+{
+	quatf_from_eulers_batch(&data->quats_out_soa, &data->eulers_soa, k_bench_count);
+}
+
+static double reference_quatf_from_eulers(const bench_data_t* data, int index, double* out)
+{
+	const vec3f_t* e = &data->eulers[index];
+	double cr = cos(e->x * 0.5);
+	double sr = sin(e->x * 0.5);
+	double cp = cos(e->y * 0.5);
+	double sp = sin(e->y * 0.5);
+	double cy = cos(e->z * 0.5);
+	double sy = sin(e->z * 0.5);
+	out[0] = cy * sr * cp - sy * cr * sp;
+	out[1] = cy * cr * sp + sy * sr * cp;
+	out[2] = sy * cr * cp - cy * sr * sp;
+	out[3] = cy * cr * cp + sy * sr * sp;
+	return 0.0;
+}
+
+// transform
+
+static void pass_transform_to_matrix(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		transform_to_matrix(&data->transforms[i], &data->matrices_out[i]);
+	}
+}
+
+static void pass_transform_to_matrix_batch(bench_data_t* data)
+{
+	transform_to_matrix_batch(data->transforms, data->matrices_out, k_bench_count);
+}
+
+static void pass_transform_to_matrix_batch_soa(bench_data_t* data)
+{
+	transform_to_matrix_batch_soa(&data->transforms_soa, data->matrices_out, k_bench_count);
+}
+
+static double reference_transform_to_matrix(const bench_data_t* data, int index, double* out)
+{
+	const transform_t* t = &data->transforms[index];
+	double q[4];
+	double r[3][3];
+	quat_to_double(&t->rotation, q);
+	quat_to_rotation_double(q, r);
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			out[i * 4 + j] = t->scale.a[i] * r[i][j];
+		}
+		out[i * 4 + 3] = 0.0;
+		out[12 + i] = t->translation.a[i];
+	}
+	out[15] = 1.0;
+	return 0.0;
+}
+
+static void pass_transform_multiply(bench_data_t* data)
+{
+	memcpy(data->transforms_out, data->transforms, sizeof(transform_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		transform_multiply(&data->transforms_out[i], &data->transforms[(i + 1) % k_bench_count]);
+	}
+}
+
+static double reference_transform_multiply(const bench_data_t* data, int index, double* out)
+{
+	const transform_t* a = &data->transforms[index];
+	const transform_t* b = &data->transforms[(index + 1) % k_bench_count];
+	double qa[4];
+	double qb[4];
+	quat_to_double(&a->rotation, qa);
+	quat_to_double(&b->rotation, qb);
+	double scaled[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		scaled[c] = (double)a->translation.a[c] * b->scale.a[c];
+	}
+	quat_rotate_double(qb, scaled, out);
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] += b->translation.a[c];
+		out[3 + c] = (double)a->scale.a[c] * b->scale.a[c];
+	}
+	quat_mul_double(qb, qa, out + 6);
+	return 0.0;
+}
+
+static void pass_transform_invert(bench_data_t* data)
+{
+	memcpy(data->transforms_out, data->transforms, sizeof(transform_t) * k_bench_count);
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		transform_invert(&data->transforms_out[i]);
+	}
+}
+
+static double reference_transform_invert(const bench_data_t* data, int index, double* out)
+{
+	const transform_t* t = &data->transforms[index];
+	double q[4];
+	quat_to_double(&t->rotation, q);
+	q[0] = -q[0];
+	q[1] = -q[1];
+	q[2] = -q[2];
+	double negated[3] = { -(double)t->translation.x, -(double)t->translation.y, -(double)t->translation.z };
+	double rotated[3];
+	quat_rotate_double(q, negated, rotated);
+	for (int c = 0; c < 3; ++c)
+	{
+		out[3 + c] = 1.0 / t->scale.a[c];
+		out[c] = out[3 + c] * rotated[c];
+	}
+	memcpy(out + 6, q, sizeof(q));
+	return 0.0;
+}
+
+static void pass_transform_vec3(bench_data_t* data)
+{
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		data->vectors_out[i] = transform_transform_vec3(&data->transforms[i], data->vectors_a[i]);
+	}
+}
+
+static double reference_transform_vec3(const bench_data_t* data, int index, double* out)
+{
+	const transform_t* t = &data->transforms[index];
+	double q[4];
+	quat_to_double(&t->rotation, q);
+	double scaled[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		scaled[c] = (double)data->vectors_a[index].a[c] * t->scale.a[c];
+	}
+	quat_rotate_double(q, scaled, out);
+	for (int c = 0; c < 3; ++c)
+	{
+		out[c] += t->translation.a[c];
+	}
+	return 0.0;
+}
+
+// Every routine, each faster version directly after the one it replaces.
+// Reference tolerances allow for float rounding at each step of each routine.
+// Faster versions that do the same arithmetic in the same order must match exactly; the others,
+// mat4f_invert and the polynomial trig in the quatf batch routines, round differently.
+static const bench_case_t k_bench_cases[] =
+{
+	{ "vec3f", "add", pass_vec3f_add, k_output_vec3f, reference_vec3f_add, 0.5f },
+	{ "vec3f", "cross", pass_vec3f_cross, k_output_vec3f, reference_vec3f_cross, 2.0f },
+	{ "vec3f", "dot", pass_vec3f_dot, k_output_float, reference_vec3f_dot, 2.0f },
+	{ "vec3f", "mag", pass_vec3f_mag, k_output_float, reference_vec3f_mag, 2.0f },
+	{ "vec3f", "norm", pass_vec3f_norm, k_output_vec3f, reference_vec3f_norm, 2.0f },
+	{ "vec3f", "lerp", pass_vec3f_lerp, k_output_vec3f, reference_vec3f_lerp, 4.0f },
+
+	{ "mat4f", "mul_scalar", pass_mat4f_mul_scalar, k_output_mat4f, reference_mat4f_mul, 4.0f },
+	{ "mat4f", "mul", pass_mat4f_mul, k_output_mat4f, reference_mat4f_mul, 4.0f, true, 0.0f },
+	{ "mat4f", "mul_batch", pass_mat4f_mul_batch, k_output_mat4f, reference_mat4f_mul, 4.0f, true, 0.0f },
+	{ "mat4f", "invert_scalar", pass_mat4f_invert_scalar, k_output_mat4f, reference_mat4f_invert, 8.0f },
+	{ "mat4f", "invert", pass_mat4f_invert, k_output_mat4f, reference_mat4f_invert, 8.0f, true, 8.0f },
+	{ "mat4f", "transpose_scalar", pass_mat4f_transpose_scalar, k_output_mat4f, reference_mat4f_transpose, 0.0f },
+	{ "mat4f", "transpose", pass_mat4f_transpose, k_output_mat4f, reference_mat4f_transpose, 0.0f, true, 0.0f },
+	{ "mat4f", "transform", pass_mat4f_transform, k_output_vec3f, reference_mat4f_transform, 4.0f },
+	{ "mat4f", "transform_points", pass_mat4f_transform_points, k_output_vec3f, reference_mat4f_transform, 4.0f, true, 0.0f },
+	{ "mat4f", "make_rotation", pass_mat4f_make_rotation, k_output_mat4f, reference_mat4f_make_rotation, 4.0f },
+
+	{ "quatf", "mul", pass_quatf_mul, k_output_quatf, reference_quatf_mul, 4.0f },
+	{ "quatf", "mul_batch", pass_quatf_mul_batch, k_output_quatf_soa, reference_quatf_mul, 4.0f, true, 0.0f },
+	{ "quatf", "rotate_vec", pass_quatf_rotate_vec, k_output_vec3f, reference_quatf_rotate_vec, 8.0f },
+	{ "quatf", "rotate_vec_batch", pass_quatf_rotate_vec_batch, k_output_vec3f_soa, reference_quatf_rotate_vec, 8.0f, true, 0.0f },
+	{ "quatf", "nlerp", pass_quatf_nlerp, k_output_quatf, reference_quatf_nlerp, 4.0f },
+	{ "quatf", "nlerp_batch", pass_quatf_nlerp_batch, k_output_quatf_soa, reference_quatf_nlerp, 4.0f, true, 0.0f },
+	{ "quatf", "slerp", pass_quatf_slerp, k_output_quatf, reference_quatf_slerp, 8.0f },
+	{ "quatf", "slerp_batch", pass_quatf_slerp_batch, k_output_quatf_soa, reference_quatf_slerp, 8.0f, true, 8.0f },
+	{ "quatf", "to_eulers", pass_quatf_to_eulers, k_output_vec3f, reference_quatf_to_eulers, 8.0f },
+	{ "quatf", "to_eulers_batch", pass_quatf_to_eulers_batch, k_output_vec3f_soa, reference_quatf_to_eulers, 8.0f, true, 8.0f },
+	{ "quatf", "from_eulers", pass_quatf_from_eulers, k_output_quatf, reference_quatf_from_eulers, 4.0f },
+	{ "quatf", "from_eulers_batch", pass_quatf_from_eulers_batch, k_output_quatf_soa, reference_quatf_from_eulers, 4.0f, true, 8.0f },
+
+	{ "transform", "to_matrix", pass_transform_to_matrix, k_output_mat4f, reference_transform_to_matrix, 4.0f },
+	{ "transform", "to_matrix_batch", pass_transform_to_matrix_batch, k_output_mat4f, reference_transform_to_matrix, 4.0f, true, 0.0f },
+	{ "transform", "to_matrix_batch_soa", pass_transform_to_matrix_batch_soa, k_output_mat4f, reference_transform_to_matrix, 4.0f, true, 0.0f },
+	{ "transform", "multiply", pass_transform_multiply, k_output_transform, reference_transform_multiply, 8.0f },
+	{ "transform", "invert", pass_transform_invert, k_output_transform, reference_transform_invert, 8.0f },
+	{ "transform", "transform_vec3", pass_transform_vec3, k_output_vec3f, reference_transform_vec3, 8.0f },
+};
+
+// Time each case, then check its results against the reference and the case before it.
+static void bench_cases(bench_results_t* results, bench_data_t* data, heap_t* heap)
+{
+	float* previous = heap_alloc(heap, sizeof(float) * k_bench_count * k_bench_max_floats, 16);
+	float* current = heap_alloc(heap, sizeof(float) * k_bench_count * k_bench_max_floats, 16);
+	for (int c = 0; c < _countof(k_bench_cases); ++c)
+	{
+		const bench_case_t* bench_case = &k_bench_cases[c];
+		uint64_t ticks = time_pass(bench_case->pass, data, bench_case->output);
+
+		float previous_ulp = 0.0f;
+		float reference_ulp = 0.0f;
+		for (int i = 0; i < k_bench_count; ++i)
+		{
+			float* actual = current + i * k_bench_max_floats;
+			double expected[k_bench_max_floats];
+			int count = read_output(data, bench_case->output, i, actual);
+			double magnitude = bench_case->reference(data, i, expected);
+			reference_ulp = __max(reference_ulp, reference_ulp_error(actual, expected, count, magnitude));
+			if (bench_case->versus_previous)
+			{
+				previous_ulp = __max(previous_ulp, ulp_error(actual, previous + i * k_bench_max_floats, count));
+			}
+		}
+		results_add(results, bench_case, ticks, previous_ulp, reference_ulp);
+
+		float* swap = previous;
+		previous = current;
+		current = swap;
+	}
+	heap_free(heap, current);
+	heap_free(heap, previous);
+}
+
+// Check the batch transform routines against transform_to_matrix() at every count up to
+// k_bench_tail_count, from an unaligned start, so their remainder loops are covered too,
+// and check that they write nothing past count.
+static void check_transform_batch_counts(bench_results_t* results, const bench_data_t* data)
+{
+	const int first = 1;
+	transform_soa_t soa = data->transforms_soa;
+	for (int c = 0; c < 3; ++c)
+	{
+		soa.translation[c] += first;
+		soa.scale[c] += first;
+	}
+	for (int c = 0; c < 4; ++c)
+	{
+		soa.rotation[c] += first;
+	}
+
+	mat4f_t expected[k_bench_tail_count];
+	for (int i = 0; i < k_bench_tail_count; ++i)
+	{
+		transform_to_matrix(&data->transforms[first + i], &expected[i]);
+	}
+
+	mat4f_t sentinel;
+	memset(&sentinel, 0xcd, sizeof(sentinel));
+	for (int count = 0; count <= k_bench_tail_count; ++count)
+	{
+		mat4f_t batch[k_bench_tail_count + 1];
+		mat4f_t batch_soa[k_bench_tail_count + 1];
+		for (int i = 0; i <= k_bench_tail_count; ++i)
+		{
+			batch[i] = sentinel;
+			batch_soa[i] = sentinel;
+		}
+		transform_to_matrix_batch(&data->transforms[first], batch, count);
+		transform_to_matrix_batch_soa(&soa, batch_soa, count);
+
+		float error = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			error = __max(error, ulp_error(&batch[i].data[0][0], &expected[i].data[0][0], 16));
+			error = __max(error, ulp_error(&batch_soa[i].data[0][0], &expected[i].data[0][0], 16));
+		}
+		bool overran = memcmp(&batch[count], &sentinel, sizeof(sentinel)) != 0 ||
+			memcmp(&batch_soa[count], &sentinel, sizeof(sentinel)) != 0;
+		if (!(error <= 0.0f) || overran)
+		{
+			debug_print(k_print_error, "math_bench transform to_matrix_batch of %d is off by %.1f ulp from to_matrix%s\n",
+				count, error, overran ? " and writes past the end" : "");
+			results->passed = false;
+		}
+	}
+}
+
+static void store_quatf(const quatf_soa_t* soa, int index, quatf_t q)
+{
+	soa->x[index] = q.x;
+	soa->y[index] = q.y;
+	soa->z[index] = q.z;
+	soa->w[index] = q.w;
+}
+
+static void store_vec3f(const vec3f_soa_t* soa, int index, vec3f_t v)
+{
+	soa->x[index] = v.x;
+	soa->y[index] = v.y;
+	soa->z[index] = v.z;
+}
+
+bool math_bench_run(heap_t* heap, fs_t* fs, const char* csv_path)
+{
+	bench_results_t results = { .heap = heap, .passed = true };
+	const char* header = "suite,variant,count,ops,ns_total,ns_per_op,max_ulp,ref_ulp\n";
+	results_append(&results, header, strlen(header));
+
+	bench_data_t data =
+	{
+		.matrices_a = heap_alloc(heap, sizeof(mat4f_t) * k_bench_count, 16),
+		.matrices_b = heap_alloc(heap, sizeof(mat4f_t) * k_bench_count, 16),
+		.transforms = heap_alloc(heap, sizeof(transform_t) * k_bench_count, 16),
+		.quats_a = heap_alloc(heap, sizeof(quatf_t) * k_bench_count, 16),
+		.quats_b = heap_alloc(heap, sizeof(quatf_t) * k_bench_count, 16),
+		.vectors_a = heap_alloc(heap, sizeof(vec3f_t) * k_bench_count, 16),
+		.vectors_b = heap_alloc(heap, sizeof(vec3f_t) * k_bench_count, 16),
+		.eulers = heap_alloc(heap, sizeof(vec3f_t) * k_bench_count, 16),
+		.vectors_out = heap_alloc(heap, sizeof(vec3f_t) * k_bench_count, 16),
+		.quats_out = heap_alloc(heap, sizeof(quatf_t) * k_bench_count, 16),
+		.matrices_out = heap_alloc(heap, sizeof(mat4f_t) * k_bench_count, 16),
+		.transforms_out = heap_alloc(heap, sizeof(transform_t) * k_bench_count, 16),
+	};
+
+	// One block holds every array of floats.
+	float* transform_fields[10];
+	float** arrays[] =
+	{
+		&data.quats_a_soa.x, &data.quats_a_soa.y, &data.quats_a_soa.z, &data.quats_a_soa.w,
+		&data.quats_b_soa.x, &data.quats_b_soa.y, &data.quats_b_soa.z, &data.quats_b_soa.w,
+		&data.vectors_a_soa.x, &data.vectors_a_soa.y, &data.vectors_a_soa.z,
+		&data.eulers_soa.x, &data.eulers_soa.y, &data.eulers_soa.z,
+		&data.vectors_out_soa.x, &data.vectors_out_soa.y, &data.vectors_out_soa.z,
+		&data.quats_out_soa.x, &data.quats_out_soa.y, &data.quats_out_soa.z, &data.quats_out_soa.w,
+		&transform_fields[0], &transform_fields[1], &transform_fields[2], &transform_fields[3], &transform_fields[4],
+		&transform_fields[5], &transform_fields[6], &transform_fields[7], &transform_fields[8], &transform_fields[9],
+		&data.t, &data.floats_out,
+	};
+	float* floats = heap_alloc(heap, sizeof(float) * k_bench_count * _countof(arrays), 16);
+	for (int a = 0; a < _countof(arrays); ++a)
+	{
+		*arrays[a] = floats + a * k_bench_count;
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		data.transforms_soa.translation[c] = transform_fields[c];
+		data.transforms_soa.scale[c] = transform_fields[3 + c];
+	}
+	for (int c = 0; c < 4; ++c)
+	{
+		data.transforms_soa.rotation[c] = transform_fields[6 + c];
+	}
+
+	// Euler angles stay within half a turn either way.
+	uint32_t seed = 12345;
+	for (int i = 0; i < k_bench_count; ++i)
+	{
+		transform_t other;
+		random_transform(&seed, &data.transforms[i]);
+		random_transform(&seed, &other);
+		transform_to_matrix(&data.transforms[i], &data.matrices_a[i]);
+		transform_to_matrix(&other, &data.matrices_b[i]);
+		data.quats_a[i] = data.transforms[i].rotation;
+		data.quats_b[i] = other.rotation;
+		data.vectors_a[i] = random_vec3f(&seed, 100.0f);
+		data.vectors_b[i] = random_vec3f(&seed, 100.0f);
+		data.eulers[i] = random_vec3f(&seed, (float)M_PI);
+		data.t[i] = 0.5f + bench_random(&seed, 0.5f);
+
+		store_quatf(&data.quats_a_soa, i, data.quats_a[i]);
+		store_quatf(&data.quats_b_soa, i, data.quats_b[i]);
+		store_vec3f(&data.vectors_a_soa, i, data.vectors_a[i]);
+		store_vec3f(&data.eulers_soa, i, data.eulers[i]);
+		const float* fields = &data.transforms[i].translation.x;
+		for (int f = 0; f < 10; ++f)
+		{
+			transform_fields[f][i] = fields[f];
+		}
+	}
+
+	bench_cases(&results, &data, heap);
+	check_transform_batch_counts(&results, &data);
+
+	heap_free(heap, floats);
+	heap_free(heap, data.transforms_out);
+	heap_free(heap, data.matrices_out);
+	heap_free(heap, data.quats_out);
+	heap_free(heap, data.vectors_out);
+	heap_free(heap, data.eulers);
+	heap_free(heap, data.vectors_b);
+	heap_free(heap, data.vectors_a);
+	heap_free(heap, data.quats_b);
+	heap_free(heap, data.quats_a);
+	heap_free(heap, data.transforms);
+	heap_free(heap, data.matrices_b);
+	heap_free(heap, data.matrices_a);
+
+	fs_work_t* work = fs_write(fs, csv_path, results.text, results.size, false);
+	fs_work_wait(work);
+	bool written = fs_work_get_result(work) == 0;
+	fs_work_destroy(work);
+	heap_free(heap, results.text);
+
+	if (!written)
+	{
+		debug_print(k_print_error, "Failed to write math benchmark results to %s\n", csv_path);
+	}
+	return written && results.passed;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Math benchmarks and accuracy checks.
+// Runs headless: needs only a heap, timer, and file system, no window or GPU.
+
+#include <stdbool.h>
+
+typedef struct fs_t fs_t;
+typedef struct heap_t heap_t;
+
+// Run every math benchmark and write the results to a CSV file.
+// Times each vec3f, mat4f, quatf and transform routine, single element and batch forms alike,
+// and checks its results against the same math done in double precision.
+// Columns: suite,variant,count,ops,ns_total,ns_per_op,max_ulp,ref_ulp
+// ref_ulp is the largest difference from the double precision result, in units of the last place
+// of the largest element of that result, or of the input lengths multiplied for dot and cross
+// products, whose results can cancel to nothing. max_ulp is the same against the row before, for rows that
+// are faster versions of it, and zero otherwise. Each row is the best of several runs.
+// Rows are also logged with debug_print(), along with any check that exceeds its tolerance.
+// The batch transform routines are also checked against transform_to_matrix() at every count
+// from 0 to 17, which covers their remainder loops.
+// Returns true if the file was written and every check passed.
+bool math_bench_run(heap_t* heap, fs_t* fs, const char* csv_path);
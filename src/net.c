@@ -26,11 +26,14 @@ enum
 
 typedef struct entity_type_t
 {
-	uint64_t component_mask;
-	uint64_t replicated_component_mask;
+	ecs_mask_t component_mask;
+	ecs_mask_t replicated_component_mask;
 	net_configure_entity_callback_t configure_callback;
 	void* configure_callback_data;
 	size_t replicated_size;
+	// Replicated component types in mask order, so packing visits only the types that are sent.
+	int replicated_types[k_ecs_max_component_types];
+	int replicated_type_count;
 } entity_type_t;
 
 typedef struct entity_data_t
@@ -46,6 +49,12 @@ typedef struct snapshot_t
 	int sequence;
 	int size;
 	char data[k_net_mtu];
+
+	// ECS version checkpoint taken with the snapshot,
+	// and the newest replicated component version of each entity in the snapshot.
+	uint32_t version;
+	int entity_count;
+	uint32_t entity_versions[k_max_entities];
 } snapshot_t;
 
 typedef struct packet_t
@@ -190,7 +199,7 @@ void net_disconnect_all(net_t* net)
 	mutex_unlock(net->connections_mutex);
 }
 
-void net_state_register_entity_type(net_t* net, int type, uint64_t component_mask, uint64_t replicated_component_mask, net_configure_entity_callback_t configure_callback, void* configure_callback_data)
+void net_state_register_entity_type(net_t* net, int type, ecs_mask_t component_mask, ecs_mask_t replicated_component_mask, net_configure_entity_callback_t configure_callback, void* configure_callback_data)
 {
 	if (type < _countof(net->entity_types))
 	{
@@ -199,12 +208,11 @@ void net_state_register_entity_type(net_t* net, int type, uint64_t component_mas
 		net->entity_types[type].configure_callback = configure_callback;
 		net->entity_types[type].configure_callback_data = configure_callback_data;
 		net->entity_types[type].replicated_size = 0;
-		for (int i = 0; i < sizeof(replicated_component_mask) * 8; ++i)
+		net->entity_types[type].replicated_type_count = 0;
+		for (int i = ecs_mask_next(replicated_component_mask, 0); i >= 0; i = ecs_mask_next(replicated_component_mask, i + 1))
 		{
-			if (replicated_component_mask & (1ULL << i))
-			{
-				net->entity_types[type].replicated_size += ecs_get_component_type_size(net->ecs, i);
-			}
+			net->entity_types[type].replicated_size += ecs_get_component_type_size(net->ecs, i);
+			net->entity_types[type].replicated_types[net->entity_types[type].replicated_type_count++] = i;
 		}
 	}
 	else
@@ -416,6 +424,8 @@ static void snapshot_entities(net_t* net)
 {
 	snapshot_t* snapshot = &net->snapshots[net->sequence % _countof(net->snapshots)];
 	snapshot->sequence = net->sequence;
+	snapshot->version = ecs_version_checkpoint(net->ecs);
+	snapshot->entity_count = 0;
 
 	char* cur = snapshot->data;
 	const char* end = &snapshot->data[_countof(snapshot->data)];
@@ -432,17 +442,18 @@ static void snapshot_entities(net_t* net)
 			memcpy(cur, &header, sizeof(header));
 			cur += sizeof(header);
 
-			uint64_t mask = net->entity_types[type].replicated_component_mask;
-			for (int c = 0; c < sizeof(mask) * 8; ++c)
+			uint32_t entity_version = 0;
+			const entity_type_t* entity_type = &net->entity_types[type];
+			for (int t = 0; t < entity_type->replicated_type_count; ++t)
 			{
-				if (mask & (1ULL << c))
-				{
-					void* component_data = ecs_entity_get_component(net->ecs, net->entities[i].ref, c, true);
-					size_t component_size = ecs_get_component_type_size(net->ecs, c);
-					memcpy(cur, component_data, component_size);
-					cur += component_size;
-				}
+				int c = entity_type->replicated_types[t];
+				const void* component_data = ecs_entity_read_component(net->ecs, net->entities[i].ref, c, true);
+				size_t component_size = ecs_get_component_type_size(net->ecs, c);
+				memcpy(cur, component_data, component_size);
+				cur += component_size;
+				entity_version = __max(entity_version, ecs_entity_get_component_version(net->ecs, net->entities[i].ref, c));
 			}
+			snapshot->entity_versions[snapshot->entity_count++] = entity_version;
 		}
 	}
 	snapshot->size = (int)(cur - snapshot->data);
@@ -465,6 +476,7 @@ static size_t packet_add_entities(connection_t* connection, char* packet, size_t
 	}
 
 	char* packet_iter = packet;
+	int entity_index = 0;
 
 	while (cur_iter < cur_end)
 	{
@@ -484,10 +496,19 @@ static size_t packet_add_entities(connection_t* connection, char* packet, size_t
 			memcpy(&ack_header, ack_iter, sizeof(ack_header));
 			if (ack_header.sequence == cur_header.sequence)
 			{
-				diff = memcmp(cur_iter, &ack_iter[sizeof(ack_header)], ent_size) != 0;
+				// Nothing replicated was written since the acked snapshot, so skip the compare.
+				if (cur_snapshot->entity_versions[entity_index] <= ack_snapshot->version)
+				{
+					diff = false;
+				}
+				else
+				{
+					diff = memcmp(cur_iter, &ack_iter[sizeof(ack_header)], ent_size) != 0;
+				}
 				ack_iter += sizeof(ack_header) + ent_size;
 			}
 		}
+		++entity_index;
 
 		*packet_iter++ = diff;
 
@@ -567,16 +588,14 @@ static void packet_read_entities(connection_t* connection, char* packet, size_t
 		bool diff = *iter++ != 0;
 		if (diff)
 		{
-			uint64_t mask = net->entity_types[header.type].replicated_component_mask;
-			for (int i = 0; i < sizeof(mask) * 8; ++i)
+			const entity_type_t* entity_type = &net->entity_types[header.type];
+			for (int t = 0; t < entity_type->replicated_type_count; ++t)
 			{
-				if (mask & (1ULL << i))
-				{
-					void* component_data = ecs_entity_get_component(net->ecs, ref, i, true);
-					size_t component_size = ecs_get_component_type_size(net->ecs, i);
-					memcpy(component_data, iter, component_size);
-					iter += component_size;
-				}
+				int c = entity_type->replicated_types[t];
+				void* component_data = ecs_entity_get_component(net->ecs, ref, c, true);
+				size_t component_size = ecs_get_component_type_size(net->ecs, c);
+				memcpy(component_data, iter, component_size);
+				iter += component_size;
 			}
 		}
 	}
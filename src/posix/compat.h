@@ -0,0 +1,32 @@
+#pragma once
+
+// MSVC extensions used by the engine, for GCC and Clang builds.
+// Force included into every source file by the CMake build; see CMakeLists.txt.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define __forceinline static inline __attribute__((always_inline))
+#define _Printf_format_string_
+
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#define __max(a, b) ((a) > (b) ? (a) : (b))
+#define __min(a, b) ((a) < (b) ? (a) : (b))
+
+#define _TRUNCATE ((size_t)-1)
+#define sprintf_s snprintf
+
+// Copy at most count characters, always null terminating within dest_size.
+static inline int strncpy_s(char* dest, size_t dest_size, const char* source, size_t count)
+{
+	size_t length = strnlen(source, count < dest_size ? count : dest_size - 1);
+	memcpy(dest, source, length);
+	dest[length] = '\0';
+	return 0;
+}
+
+static inline int strcpy_s(char* dest, size_t dest_size, const char* source)
+{
+	return strncpy_s(dest, dest_size, source, _TRUNCATE);
+}
@@ -0,0 +1,23 @@
+#include "debug.h"
+#include "ecs_bench.h"
+#include "fs.h"
+#include "heap.h"
+#include "timer.h"
+
+// Entry point for the headless ECS benchmark on Linux; the Windows build runs it with main.exe --bench-ecs.
+// Usage: ecs_bench [results.csv]
+int main(int argc, const char* argv[])
+{
+	debug_set_print_mask(k_print_info | k_print_warning | k_print_error);
+
+	timer_startup();
+
+	heap_t* heap = heap_create(2 * 1024 * 1024);
+	fs_t* fs = fs_create(heap, 8);
+
+	bool written = ecs_bench_run(heap, fs, argc >= 2 ? argv[1] : "ecs_bench.csv");
+
+	fs_destroy(fs);
+	heap_destroy(heap);
+	return written ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Stand-in for MSVC's <intrin.h> on GCC and Clang.
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+// Find the lowest set bit. Returns zero if mask is zero.
+static inline unsigned char _BitScanForward(unsigned long* index, unsigned long mask)
+{
+	if (!(uint32_t)mask)
+	{
+		return 0;
+	}
+	*index = (unsigned long)__builtin_ctz((uint32_t)mask);
+	return 1;
+}
+
+static inline unsigned char _BitScanForward64(unsigned long* index, unsigned long long mask)
+{
+	if (!mask)
+	{
+		return 0;
+	}
+	*index = (unsigned long)__builtin_ctzll(mask);
+	return 1;
+}
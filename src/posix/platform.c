@@ -0,0 +1,250 @@
+// POSIX versions of the platform layer the headless benchmarks need:
+// heap, debug printing, timer, atomics, and a synchronous file system.
+// The Windows build uses heap.c, debug.c, timer.c, atomic.c, and fs.c instead.
+
+#include "atomic.h"
+#include "debug.h"
+#include "fs.h"
+#include "heap.h"
+#include "timer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct heap_t
+{
+	int allocation_count;
+} heap_t;
+
+typedef struct fs_t
+{
+	heap_t* heap;
+} fs_t;
+
+typedef struct fs_work_t
+{
+	heap_t* heap;
+	void* buffer;
+	size_t size;
+	int result;
+} fs_work_t;
+
+static uint32_t s_mask = 0xffffffff;
+static uint64_t s_ticks_start = 0;
+
+heap_t* heap_create(size_t grow_increment)
+{
+	heap_t* heap = calloc(1, sizeof(heap_t));
+	if (!heap)
+	{
+		debug_print(k_print_error, "OUT OF MEMORY!\n");
+	}
+	return heap;
+}
+
+void heap_destroy(heap_t* heap)
+{
+	if (heap->allocation_count)
+	{
+		debug_print(k_print_warning, "Memory leak of %d allocations\n", heap->allocation_count);
+	}
+	free(heap);
+}
+
+void* heap_alloc(heap_t* heap, size_t size, size_t alignment)
+{
+	void* address = NULL;
+	if (posix_memalign(&address, __max(alignment, sizeof(void*)), size ? size : 1))
+	{
+		debug_print(k_print_error, "OUT OF MEMORY!\n");
+		return NULL;
+	}
+	atomic_increment(&heap->allocation_count);
+	return address;
+}
+
+void heap_free(heap_t* heap, void* address)
+{
+	atomic_decrement(&heap->allocation_count);
+	free(address);
+}
+
+void debug_install_exception_handler()
+{
+}
+
+void debug_set_print_mask(uint32_t mask)
+{
+	s_mask = mask;
+}
+
+void debug_print(uint32_t type, _Printf_format_string_ const char* format, ...)
+{
+	if ((s_mask & type) == 0)
+	{
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+int debug_backtrace(void** stack, int stack_capacity)
+{
+	return 0;
+}
+
+void timer_startup()
+{
+	s_ticks_start = timer_get_ticks();
+}
+
+uint64_t timer_ticks_to_us(uint64_t t)
+{
+	return t / 1000;
+}
+
+uint32_t timer_ticks_to_ms(uint64_t t)
+{
+	return (uint32_t)(t / 1000000);
+}
+
+uint64_t timer_get_ticks()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec - s_ticks_start;
+}
+
+uint64_t timer_get_ticks_per_second()
+{
+	return 1000000000ull;
+}
+
+int atomic_increment(int* address)
+{
+	return __atomic_fetch_add(address, 1, __ATOMIC_SEQ_CST);
+}
+
+int atomic_decrement(int* address)
+{
+	return __atomic_fetch_sub(address, 1, __ATOMIC_SEQ_CST);
+}
+
+int atomic_compare_and_exchange(int* dest, int compare, int exchange)
+{
+	__atomic_compare_exchange_n(dest, &compare, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return compare;
+}
+
+int atomic_load(int* address)
+{
+	return __atomic_load_n(address, __ATOMIC_SEQ_CST);
+}
+
+void atomic_store(int* address, int value)
+{
+	__atomic_store_n(address, value, __ATOMIC_SEQ_CST);
+}
+
+fs_t* fs_create(heap_t* heap, int queue_capacity)
+{
+	fs_t* fs = heap_alloc(heap, sizeof(fs_t), 8);
+	fs->heap = heap;
+	return fs;
+}
+
+void fs_destroy(fs_t* fs)
+{
+	heap_free(fs->heap, fs);
+}
+
+// Work runs to completion before fs_read() and fs_write() return.
+// Compression is not supported; asking for it fails the work.
+fs_work_t* fs_read(fs_t* fs, const char* path, heap_t* heap, bool null_terminate, bool use_compression)
+{
+	fs_work_t* work = heap_alloc(fs->heap, sizeof(fs_work_t), 8);
+	*work = (fs_work_t){ .heap = fs->heap, .result = -1 };
+
+	FILE* file = use_compression ? NULL : fopen(path, "rb");
+	if (!file)
+	{
+		return work;
+	}
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		long size = ftell(file);
+		if (size >= 0 && fseek(file, 0, SEEK_SET) == 0)
+		{
+			work->size = (size_t)size;
+			work->buffer = heap_alloc(heap, null_terminate ? work->size + 1 : work->size, 8);
+			if (fread(work->buffer, 1, work->size, file) == work->size)
+			{
+				work->result = 0;
+			}
+			if (null_terminate)
+			{
+				((char*)work->buffer)[work->size] = 0;
+			}
+		}
+	}
+	fclose(file);
+	return work;
+}
+
+fs_work_t* fs_write(fs_t* fs, const char* path, const void* buffer, size_t size, bool use_compression)
+{
+	fs_work_t* work = heap_alloc(fs->heap, sizeof(fs_work_t), 8);
+	*work = (fs_work_t){ .heap = fs->heap, .size = size, .result = -1 };
+
+	FILE* file = use_compression ? NULL : fopen(path, "wb");
+	if (!file)
+	{
+		return work;
+	}
+	if (fwrite(buffer, 1, size, file) == size)
+	{
+		work->result = 0;
+	}
+	if (fclose(file) != 0)
+	{
+		work->result = -1;
+	}
+	return work;
+}
+
+bool fs_work_is_done(fs_work_t* work)
+{
+	return true;
+}
+
+void fs_work_wait(fs_work_t* work)
+{
+}
+
+int fs_work_get_result(fs_work_t* work)
+{
+	return work ? work->result : -1;
+}
+
+void* fs_work_get_buffer(fs_work_t* work)
+{
+	return work ? work->buffer : NULL;
+}
+
+size_t fs_work_get_size(fs_work_t* work)
+{
+	return work ? work->size : 0;
+}
+
+void fs_work_destroy(fs_work_t* work)
+{
+	if (work)
+	{
+		heap_free(work->heap, work);
+	}
+}
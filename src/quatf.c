@@ -1,8 +1,79 @@
 #include "quatf.h"
 
+#include "simd.h"
+
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+typedef struct quatf_lanes_t
+{
+	simdf_t x, y, z, w;
+} quatf_lanes_t;
+
+typedef struct vec3f_lanes_t
+{
+	simdf_t x, y, z;
+} vec3f_lanes_t;
+
+static quatf_lanes_t load_quatf_lanes(const quatf_soa_t* q, int index, int count);
+static void store_quatf_lanes(const quatf_soa_t* q, int index, int count, const quatf_lanes_t* lanes);
+static vec3f_lanes_t load_vec3f_lanes(const vec3f_soa_t* v, int index, int count);
+static void store_vec3f_lanes(const vec3f_soa_t* v, int index, int count, const vec3f_lanes_t* lanes);
+static vec3f_lanes_t cross_lanes(vec3f_lanes_t a, vec3f_lanes_t b);
+static simdf_t dot_lanes(const quatf_lanes_t* a, const quatf_lanes_t* b);
+static quatf_lanes_t nlerp_lanes(const quatf_lanes_t* a, const quatf_lanes_t* b, simdf_t t);
+static simdf_t negate_lanes(simdm_t mask, simdf_t v);
+static void sincos_lanes(simdf_t x, simdf_t* sin_out, simdf_t* cos_out);
+static simdf_t atan2_lanes(simdf_t y, simdf_t x);
+
+quatf_t quatf_nlerp(quatf_t a, quatf_t b, float t)
+{
+	// q and -q are the same rotation; negating b's weight takes the shorter way around.
+	float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	float ta = 1.0f - t;
+	float tb = d < 0.0f ? -t : t;
+
+	quatf_t result =
+	{
+		.x = a.x * ta + b.x * tb,
+		.y = a.y * ta + b.y * tb,
+		.z = a.z * ta + b.z * tb,
+		.w = a.w * ta + b.w * tb,
+	};
+	float inv_length = 1.0f / sqrtf(result.x * result.x + result.y * result.y + result.z * result.z + result.w * result.w);
+	result.x *= inv_length;
+	result.y *= inv_length;
+	result.z *= inv_length;
+	result.w *= inv_length;
+	return result;
+}
+
+quatf_t quatf_slerp(quatf_t a, quatf_t b, float t)
+{
+	float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	float sign = d < 0.0f ? -1.0f : 1.0f;
+	d = fabsf(d);
+
+	// Nearly equal rotations would divide by a tiny sine; the arc is a straight line there anyway.
+	if (d > 0.9995f)
+	{
+		return quatf_nlerp(a, b, t);
+	}
+
+	float theta = acosf(d);
+	float sin_theta = sqrtf((1.0f - d) * (1.0f + d));
+	float ta = sinf((1.0f - t) * theta) / sin_theta;
+	float tb = sign * sinf(t * theta) / sin_theta;
+
+	return (quatf_t)
+	{
+		.x = a.x * ta + b.x * tb,
+		.y = a.y * ta + b.y * tb,
+		.z = a.z * ta + b.z * tb,
+		.w = a.w * ta + b.w * tb,
+	};
+}
+
 vec3f_t quatf_to_eulers(quatf_t q)
 {
 	/* From wikipedia: https://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles */
@@ -29,7 +100,7 @@ vec3f_t quatf_to_eulers(quatf_t q)
 	float cosy = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
 	float yaw = atan2f(siny, cosy);
 
-	return (vec3f_t) { .x = roll, .x = pitch, .x = yaw };
+	return (vec3f_t) { .x = roll, .y = pitch, .z = yaw };
 }
 
 quatf_t quatf_from_eulers(vec3f_t euler_angles)
@@ -55,3 +126,291 @@ quatf_t quatf_from_eulers(vec3f_t euler_angles)
 		.z = sy * cr * cp - cy * sr * sp,
 	};
 }
+
+void quatf_mul_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, int count)
+{
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		quatf_lanes_t qa = load_quatf_lanes(a, i, count - i);
+		quatf_lanes_t qb = load_quatf_lanes(b, i, count - i);
+		vec3f_lanes_t va = { qa.x, qa.y, qa.z };
+		vec3f_lanes_t vb = { qb.x, qb.y, qb.z };
+
+		// Same operation order as quatf_mul().
+		vec3f_lanes_t v = cross_lanes(va, vb);
+		quatf_lanes_t r;
+		r.x = simdf_add(simdf_add(v.x, simdf_mul(vb.x, qa.w)), simdf_mul(va.x, qb.w));
+		r.y = simdf_add(simdf_add(v.y, simdf_mul(vb.y, qa.w)), simdf_mul(va.y, qb.w));
+		r.z = simdf_add(simdf_add(v.z, simdf_mul(vb.z, qa.w)), simdf_mul(va.z, qb.w));
+		simdf_t dot = simdf_add(simdf_add(simdf_mul(va.x, vb.x), simdf_mul(va.y, vb.y)), simdf_mul(va.z, vb.z));
+		r.w = simdf_sub(simdf_mul(qa.w, qb.w), dot);
+
+		store_quatf_lanes(result, i, count - i, &r);
+	}
+}
+
+void quatf_rotate_vec_batch(const vec3f_soa_t* result, const quatf_soa_t* q, const vec3f_soa_t* v, int count)
+{
+	simdf_t two = simdf_set1(2.0f);
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		quatf_lanes_t r = load_quatf_lanes(q, i, count - i);
+		vec3f_lanes_t qv = { r.x, r.y, r.z };
+		vec3f_lanes_t p = load_vec3f_lanes(v, i, count - i);
+
+		vec3f_lanes_t t = cross_lanes(qv, p);
+		t.x = simdf_mul(t.x, two);
+		t.y = simdf_mul(t.y, two);
+		t.z = simdf_mul(t.z, two);
+		vec3f_lanes_t c = cross_lanes(qv, t);
+		p.x = simdf_add(p.x, simdf_add(simdf_mul(t.x, r.w), c.x));
+		p.y = simdf_add(p.y, simdf_add(simdf_mul(t.y, r.w), c.y));
+		p.z = simdf_add(p.z, simdf_add(simdf_mul(t.z, r.w), c.z));
+
+		store_vec3f_lanes(result, i, count - i, &p);
+	}
+}
+
+void quatf_nlerp_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, const float* t, int count)
+{
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		quatf_lanes_t qa = load_quatf_lanes(a, i, count - i);
+		quatf_lanes_t qb = load_quatf_lanes(b, i, count - i);
+		quatf_lanes_t r = nlerp_lanes(&qa, &qb, simdf_load_partial(t + i, count - i));
+		store_quatf_lanes(result, i, count - i, &r);
+	}
+}
+
+void quatf_slerp_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, const float* t, int count)
+{
+	simdf_t zero = simdf_set1(0.0f);
+	simdf_t one = simdf_set1(1.0f);
+	simdf_t nlerp_threshold = simdf_set1(0.9995f);
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		quatf_lanes_t qa = load_quatf_lanes(a, i, count - i);
+		quatf_lanes_t qb = load_quatf_lanes(b, i, count - i);
+		simdf_t lt = simdf_load_partial(t + i, count - i);
+
+		simdf_t d = dot_lanes(&qa, &qb);
+		simdm_t flip = simdf_lt(d, zero);
+		d = simdf_abs(d);
+
+		// acos(d) as atan2(sin, cos), sharing the sine with the weights below.
+		simdf_t sin_theta = simdf_sqrt(simdf_mul(simdf_sub(one, d), simdf_add(one, d)));
+		simdf_t theta = atan2_lanes(sin_theta, d);
+		simdf_t sin_a, sin_b, unused;
+		sincos_lanes(simdf_mul(simdf_sub(one, lt), theta), &sin_a, &unused);
+		sincos_lanes(simdf_mul(lt, theta), &sin_b, &unused);
+		simdf_t ta = simdf_div(sin_a, sin_theta);
+		simdf_t tb = negate_lanes(flip, simdf_div(sin_b, sin_theta));
+
+		quatf_lanes_t r;
+		r.x = simdf_add(simdf_mul(qa.x, ta), simdf_mul(qb.x, tb));
+		r.y = simdf_add(simdf_mul(qa.y, ta), simdf_mul(qb.y, tb));
+		r.z = simdf_add(simdf_mul(qa.z, ta), simdf_mul(qb.z, tb));
+		r.w = simdf_add(simdf_mul(qa.w, ta), simdf_mul(qb.w, tb));
+
+		// Lanes with nearly equal rotations take nlerp, as quatf_slerp() does.
+		simdm_t nearly_equal = simdf_lt(nlerp_threshold, d);
+		if (simdm_bits(nearly_equal))
+		{
+			quatf_lanes_t n = nlerp_lanes(&qa, &qb, lt);
+			r.x = simdf_select(nearly_equal, n.x, r.x);
+			r.y = simdf_select(nearly_equal, n.y, r.y);
+			r.z = simdf_select(nearly_equal, n.z, r.z);
+			r.w = simdf_select(nearly_equal, n.w, r.w);
+		}
+
+		store_quatf_lanes(result, i, count - i, &r);
+	}
+}
+
+void quatf_to_eulers_batch(const vec3f_soa_t* result, const quatf_soa_t* q, int count)
+{
+	simdf_t one = simdf_set1(1.0f);
+	simdf_t two = simdf_set1(2.0f);
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		quatf_lanes_t r = load_quatf_lanes(q, i, count - i);
+		vec3f_lanes_t e;
+
+		simdf_t sinr = simdf_mul(two, simdf_add(simdf_mul(r.w, r.x), simdf_mul(r.y, r.z)));
+		simdf_t cosr = simdf_sub(one, simdf_mul(two, simdf_add(simdf_mul(r.x, r.x), simdf_mul(r.y, r.y))));
+		e.x = atan2_lanes(sinr, cosr);
+
+		// asin(sinp) as atan2(sinp, cos), clamped to 90 degrees when out of range.
+		simdf_t sinp = simdf_mul(two, simdf_sub(simdf_mul(r.w, r.y), simdf_mul(r.z, r.x)));
+		sinp = simdf_max(simdf_min(sinp, one), simdf_set1(-1.0f));
+		simdf_t cosp = simdf_sqrt(simdf_mul(simdf_sub(one, sinp), simdf_add(one, sinp)));
+		e.y = atan2_lanes(sinp, cosp);
+
+		simdf_t siny = simdf_mul(two, simdf_add(simdf_mul(r.w, r.z), simdf_mul(r.x, r.y)));
+		simdf_t cosy = simdf_sub(one, simdf_mul(two, simdf_add(simdf_mul(r.y, r.y), simdf_mul(r.z, r.z))));
+		e.z = atan2_lanes(siny, cosy);
+
+		store_vec3f_lanes(result, i, count - i, &e);
+	}
+}
+
+void quatf_from_eulers_batch(const quatf_soa_t* result, const vec3f_soa_t* euler_angles, int count)
+{
+	simdf_t half = simdf_set1(0.5f);
+	for (int i = 0; i < count; i += k_simd_width)
+	{
+		vec3f_lanes_t e = load_vec3f_lanes(euler_angles, i, count - i);
+		simdf_t sr, cr, sp, cp, sy, cy;
+		sincos_lanes(simdf_mul(e.x, half), &sr, &cr);
+		sincos_lanes(simdf_mul(e.y, half), &sp, &cp);
+		sincos_lanes(simdf_mul(e.z, half), &sy, &cy);
+
+		quatf_lanes_t r;
+		r.w = simdf_add(simdf_mul(simdf_mul(cy, cr), cp), simdf_mul(simdf_mul(sy, sr), sp));
+		r.x = simdf_sub(simdf_mul(simdf_mul(cy, sr), cp), simdf_mul(simdf_mul(sy, cr), sp));
+		r.y = simdf_add(simdf_mul(simdf_mul(cy, cr), sp), simdf_mul(simdf_mul(sy, sr), cp));
+		r.z = simdf_sub(simdf_mul(simdf_mul(sy, cr), cp), simdf_mul(simdf_mul(cy, sr), sp));
+
+		store_quatf_lanes(result, i, count - i, &r);
+	}
+}
+
+static quatf_lanes_t load_quatf_lanes(const quatf_soa_t* q, int index, int count)
+{
+	return (quatf_lanes_t)
+	{
+		.x = simdf_load_partial(q->x + index, count),
+		.y = simdf_load_partial(q->y + index, count),
+		.z = simdf_load_partial(q->z + index, count),
+		.w = simdf_load_partial(q->w + index, count),
+	};
+}
+
+static void store_quatf_lanes(const quatf_soa_t* q, int index, int count, const quatf_lanes_t* lanes)
+{
+	simdf_store_partial(q->x + index, lanes->x, count);
+	simdf_store_partial(q->y + index, lanes->y, count);
+	simdf_store_partial(q->z + index, lanes->z, count);
+	simdf_store_partial(q->w + index, lanes->w, count);
+}
+
+static vec3f_lanes_t load_vec3f_lanes(const vec3f_soa_t* v, int index, int count)
+{
+	return (vec3f_lanes_t)
+	{
+		.x = simdf_load_partial(v->x + index, count),
+		.y = simdf_load_partial(v->y + index, count),
+		.z = simdf_load_partial(v->z + index, count),
+	};
+}
+
+static void store_vec3f_lanes(const vec3f_soa_t* v, int index, int count, const vec3f_lanes_t* lanes)
+{
+	simdf_store_partial(v->x + index, lanes->x, count);
+	simdf_store_partial(v->y + index, lanes->y, count);
+	simdf_store_partial(v->z + index, lanes->z, count);
+}
+
+static vec3f_lanes_t cross_lanes(vec3f_lanes_t a, vec3f_lanes_t b)
+{
+	return (vec3f_lanes_t)
+	{
+		.x = simdf_sub(simdf_mul(a.y, b.z), simdf_mul(a.z, b.y)),
+		.y = simdf_sub(simdf_mul(a.z, b.x), simdf_mul(a.x, b.z)),
+		.z = simdf_sub(simdf_mul(a.x, b.y), simdf_mul(a.y, b.x)),
+	};
+}
+
+static simdf_t dot_lanes(const quatf_lanes_t* a, const quatf_lanes_t* b)
+{
+	simdf_t d = simdf_add(simdf_mul(a->x, b->x), simdf_mul(a->y, b->y));
+	d = simdf_add(d, simdf_mul(a->z, b->z));
+	return simdf_add(d, simdf_mul(a->w, b->w));
+}
+
+static quatf_lanes_t nlerp_lanes(const quatf_lanes_t* a, const quatf_lanes_t* b, simdf_t t)
+{
+	// Same operation order as quatf_nlerp().
+	simdf_t ta = simdf_sub(simdf_set1(1.0f), t);
+	simdf_t tb = negate_lanes(simdf_lt(dot_lanes(a, b), simdf_set1(0.0f)), t);
+
+	quatf_lanes_t r;
+	r.x = simdf_add(simdf_mul(a->x, ta), simdf_mul(b->x, tb));
+	r.y = simdf_add(simdf_mul(a->y, ta), simdf_mul(b->y, tb));
+	r.z = simdf_add(simdf_mul(a->z, ta), simdf_mul(b->z, tb));
+	r.w = simdf_add(simdf_mul(a->w, ta), simdf_mul(b->w, tb));
+
+	simdf_t inv_length = simdf_div(simdf_set1(1.0f), simdf_sqrt(dot_lanes(&r, &r)));
+	r.x = simdf_mul(r.x, inv_length);
+	r.y = simdf_mul(r.y, inv_length);
+	r.z = simdf_mul(r.z, inv_length);
+	r.w = simdf_mul(r.w, inv_length);
+	return r;
+}
+
+static simdf_t negate_lanes(simdm_t mask, simdf_t v)
+{
+	return simdf_select(mask, simdf_sub(simdf_set1(0.0f), v), v);
+}
+
+static void sincos_lanes(simdf_t x, simdf_t* sin_out, simdf_t* cos_out)
+{
+	/* Polynomials and three part reduction from Cephes sinf/cosf. Accurate for |x| up to a few thousand. */
+
+	// Reduce x to r in [-pi/4, pi/4] and the quadrant q, with x = q * pi/2 + r.
+	simdf_t q = simdf_round(simdf_mul(x, simdf_set1((float)(2.0 / M_PI))));
+	simdf_t r = simdf_sub(x, simdf_mul(q, simdf_set1(1.5703125f)));
+	r = simdf_sub(r, simdf_mul(q, simdf_set1(4.837512969970703125e-4f)));
+	r = simdf_sub(r, simdf_mul(q, simdf_set1(7.54978995489188216e-8f)));
+
+	simdf_t z = simdf_mul(r, r);
+	simdf_t s = simdf_mul(z, simdf_set1(-1.9515295891e-4f));
+	s = simdf_mul(z, simdf_add(s, simdf_set1(8.3321608736e-3f)));
+	s = simdf_mul(z, simdf_add(s, simdf_set1(-1.6666654611e-1f)));
+	s = simdf_add(r, simdf_mul(r, s));
+
+	simdf_t c = simdf_mul(z, simdf_set1(2.443315711809948e-5f));
+	c = simdf_mul(z, simdf_add(c, simdf_set1(-1.388731625493765e-3f)));
+	c = simdf_mul(z, simdf_add(c, simdf_set1(4.166664568298827e-2f)));
+	c = simdf_add(simdf_sub(simdf_set1(1.0f), simdf_mul(z, simdf_set1(0.5f))), simdf_mul(z, c));
+
+	// Quadrant in [-2, 2]; odd quadrants swap sine and cosine.
+	simdf_t m = simdf_sub(q, simdf_mul(simdf_set1(4.0f), simdf_round(simdf_mul(q, simdf_set1(0.25f)))));
+	simdf_t abs_m = simdf_abs(m);
+	simdm_t swap = simdf_eq(abs_m, simdf_set1(1.0f));
+	simdm_t half_turn = simdf_eq(abs_m, simdf_set1(2.0f));
+	simdf_t zero = simdf_set1(0.0f);
+
+	*sin_out = negate_lanes(simdm_or(simdf_lt(m, zero), half_turn), simdf_select(swap, c, s));
+	*cos_out = negate_lanes(simdm_or(simdf_lt(zero, m), half_turn), simdf_select(swap, s, c));
+}
+
+static simdf_t atan2_lanes(simdf_t y, simdf_t x)
+{
+	/* Polynomial and range reduction from Cephes atanf. */
+
+	simdf_t zero = simdf_set1(0.0f);
+	simdf_t one = simdf_set1(1.0f);
+	simdf_t abs_x = simdf_abs(x);
+	simdf_t abs_y = simdf_abs(y);
+
+	// Ratio in [0, 1], then into [-tan(pi/8), tan(pi/8)] for the polynomial.
+	simdf_t ratio = simdf_div(simdf_min(abs_x, abs_y), simdf_max(abs_x, abs_y));
+	ratio = simdf_select(simdf_eq(simdf_max(abs_x, abs_y), zero), zero, ratio);
+	simdm_t reduce = simdf_lt(simdf_set1(0.4142135623730950f), ratio);
+	ratio = simdf_select(reduce, simdf_div(simdf_sub(ratio, one), simdf_add(ratio, one)), ratio);
+
+	simdf_t z = simdf_mul(ratio, ratio);
+	simdf_t a = simdf_mul(z, simdf_set1(8.05374449538e-2f));
+	a = simdf_mul(z, simdf_add(a, simdf_set1(-1.38776856032e-1f)));
+	a = simdf_mul(z, simdf_add(a, simdf_set1(1.99777106478e-1f)));
+	a = simdf_mul(z, simdf_add(a, simdf_set1(-3.33329491539e-1f)));
+	a = simdf_add(ratio, simdf_mul(ratio, a));
+	a = simdf_add(a, simdf_select(reduce, simdf_set1((float)M_PI_4), zero));
+
+	// Back out to the full circle: mirror about 45 degrees, then about the y axis, then x.
+	a = simdf_select(simdf_lt(abs_x, abs_y), simdf_sub(simdf_set1((float)M_PI_2), a), a);
+	simdm_t negative_x = simdf_lt(simdf_copysign(one, x), zero);
+	a = simdf_select(negative_x, simdf_sub(simdf_set1((float)M_PI), a), a);
+	return simdf_copysign(a, y);
+}
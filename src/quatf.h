@@ -4,6 +4,15 @@
 
 #include "vec3f.h"
 
+// Quaternions stored as one array per component, for the batch functions below.
+typedef struct quatf_soa_t
+{
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+} quatf_soa_t;
+
 // Quaternion object.
 typedef struct quatf_t
 {
@@ -51,8 +60,35 @@ __forceinline vec3f_t quatf_rotate_vec(quatf_t q, vec3f_t v)
 	return vec3f_add(v, vec3f_add(vec3f_scale(t, q.w), vec3f_cross(q.v3, t)));
 }
 
+// Interpolates between two normalized quaternions along the shortest path.
+// Blends the components linearly and normalizes the result. Cheap, but the
+// rotation does not move at a constant speed as t changes.
+quatf_t quatf_nlerp(quatf_t a, quatf_t b, float t);
+
+// Spherically interpolates between two normalized quaternions along the shortest path.
+// Rotates at a constant speed as t changes. Falls back to nlerp for nearly equal inputs.
+quatf_t quatf_slerp(quatf_t a, quatf_t b, float t);
+
 // Converts a quaternion to representation with 3 angles in radians: roll, yaw, pitch.
 vec3f_t quatf_to_eulers(quatf_t q);
 
 // Converts roll, yaw, pitch in radians to a quaternion.
 quatf_t quatf_from_eulers(vec3f_t euler_angles);
+
+// Batch versions of the functions above, over count elements stored as arrays of components.
+// Runs k_simd_width elements at a time (see simd.h). Results may use the same arrays as inputs.
+// The Euler conversions use polynomial trig accurate to a few units in the last place.
+
+void quatf_mul_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, int count);
+
+void quatf_rotate_vec_batch(const vec3f_soa_t* result, const quatf_soa_t* q, const vec3f_soa_t* v, int count);
+
+// t holds one interpolation factor per element.
+void quatf_nlerp_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, const float* t, int count);
+
+// t holds one interpolation factor per element.
+void quatf_slerp_batch(const quatf_soa_t* result, const quatf_soa_t* a, const quatf_soa_t* b, const float* t, int count);
+
+void quatf_to_eulers_batch(const vec3f_soa_t* result, const quatf_soa_t* q, int count);
+
+void quatf_from_eulers_batch(const quatf_soa_t* result, const vec3f_soa_t* euler_angles, int count);
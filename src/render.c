@@ -28,6 +28,7 @@ typedef struct model_command_t
 	gpu_mesh_info_t* mesh;
 	gpu_shader_info_t* shader;
 	gpu_uniform_buffer_info_t uniform_buffer;
+	uint32_t uniform_version;
 } model_command_t;
 
 typedef struct frame_done_command_t
@@ -39,6 +40,8 @@ typedef struct draw_instance_t
 {
 	ecs_entity_ref_t entity;
 	gpu_uniform_buffer_t** uniform_buffers;
+	// Version of the data last uploaded to each uniform buffer, zero if unknown.
+	uint32_t* uniform_versions;
 	gpu_descriptor_t** descriptors;
 	int frame_counter;
 } draw_instance_t;
@@ -105,7 +108,7 @@ void render_destroy(render_t* render)
 	heap_free(render->heap, render);
 }
 
-void render_push_model(render_t* render, ecs_entity_ref_t* entity, gpu_mesh_info_t* mesh, gpu_shader_info_t* shader, gpu_uniform_buffer_info_t* uniform)
+void render_push_model(render_t* render, ecs_entity_ref_t* entity, gpu_mesh_info_t* mesh, gpu_shader_info_t* shader, gpu_uniform_buffer_info_t* uniform, uint32_t uniform_version)
 {
 	model_command_t* command = heap_alloc(render->heap, sizeof(model_command_t), 8);
 	command->type = k_command_model;
@@ -115,6 +118,7 @@ void render_push_model(render_t* render, ecs_entity_ref_t* entity, gpu_mesh_info
 	command->uniform_buffer.size = uniform->size;
 	command->uniform_buffer.data = heap_alloc(render->heap, uniform->size, 8);
 	memcpy(command->uniform_buffer.data, uniform->data, uniform->size);
+	command->uniform_version = uniform_version;
 	queue_push(render->queue, command);
 }
 
@@ -274,10 +278,12 @@ static draw_instance_t* create_or_get_instance_for_model_command(render_t* rende
 
 		instance->entity = command->entity;
 		instance->uniform_buffers = heap_alloc(render->heap, sizeof(gpu_uniform_buffer_t*) * render->gpu_frame_count, 8);
+		instance->uniform_versions = heap_alloc(render->heap, sizeof(uint32_t) * render->gpu_frame_count, 8);
 		instance->descriptors = heap_alloc(render->heap, sizeof(gpu_descriptor_t*) * render->gpu_frame_count, 8);
 		for (int i = 0; i < render->gpu_frame_count; ++i)
 		{
 			instance->uniform_buffers[i] = gpu_uniform_buffer_create(render->gpu, &command->uniform_buffer);
+			instance->uniform_versions[i] = command->uniform_version;
 
 			gpu_descriptor_info_t descriptor_info =
 			{
@@ -289,8 +295,13 @@ static draw_instance_t* create_or_get_instance_for_model_command(render_t* rende
 		}
 	}
 
+	// Each frame in flight has its own buffer, so skip only when this frame's buffer already holds the data.
 	int frame_index = render->frame_counter % render->gpu_frame_count;
-	gpu_uniform_buffer_update(render->gpu, instance->uniform_buffers[frame_index], command->uniform_buffer.data, command->uniform_buffer.size);
+	if (!command->uniform_version || instance->uniform_versions[frame_index] != command->uniform_version)
+	{
+		gpu_uniform_buffer_update(render->gpu, instance->uniform_buffers[frame_index], command->uniform_buffer.data, command->uniform_buffer.size);
+		instance->uniform_versions[frame_index] = command->uniform_version;
+	}
 
 	instance->frame_counter = render->frame_counter;
 
@@ -309,6 +320,7 @@ static void destroy_stale_data(render_t* render)
 				gpu_uniform_buffer_destroy(render->gpu, render->instances[i].uniform_buffers[f]);
 			}
 			heap_free(render->heap, render->instances[i].descriptors);
+			heap_free(render->heap, render->instances[i].uniform_versions);
 			heap_free(render->heap, render->instances[i].uniform_buffers);
 			render->instances[i] = render->instances[render->instance_count - 1];
 			render->instance_count--;
@@ -2,6 +2,8 @@
 
 // High-level graphics rendering interface.
 
+#include <stdint.h>
+
 typedef struct render_t render_t;
 
 typedef struct ecs_entity_ref_t ecs_entity_ref_t;
@@ -18,7 +20,9 @@ render_t* render_create(heap_t* heap, wm_window_t* window);
 void render_destroy(render_t* render);
 
 // Push a model onto a queue of items to be rendered.
-void render_push_model(render_t* render, ecs_entity_ref_t* entity, gpu_mesh_info_t* mesh, gpu_shader_info_t* shader, gpu_uniform_buffer_info_t* uniform);
+// uniform_version identifies the uniform data: when it matches the version last uploaded for the entity,
+// the upload is skipped. Pass zero to upload every time.
+void render_push_model(render_t* render, ecs_entity_ref_t* entity, gpu_mesh_info_t* mesh, gpu_shader_info_t* shader, gpu_uniform_buffer_info_t* uniform, uint32_t uniform_version);
 
 // Push an end-of-frame marker on a queue of items to be rendered.
 void render_push_done(render_t* render);
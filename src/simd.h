@@ -0,0 +1,312 @@
+#pragma once
+
+// SIMD float vectors.
+// Wraps the widest float vector the build targets: 8 lanes with AVX2, 4 lanes with SSE2,
+// and a single float otherwise, so batch kernels are written once and keep a scalar fallback.
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+
+// simdm_t holds the result of a comparison per lane, for simdf_select().
+#if defined(SIMD_AVX2)
+enum { k_simd_width = 8 };
+typedef __m256 simdf_t;
+typedef __m256 simdm_t;
+#elif defined(SIMD_SSE2)
+enum { k_simd_width = 4 };
+typedef __m128 simdf_t;
+typedef __m128 simdm_t;
+#else
+enum { k_simd_width = 1 };
+typedef float simdf_t;
+typedef bool simdm_t;
+#endif
+
+// Returns a vector with every lane set to f.
+__forceinline simdf_t simdf_set1(float f)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_set1_ps(f);
+#elif defined(SIMD_SSE2)
+	return _mm_set1_ps(f);
+#else
+	return f;
+#endif
+}
+
+// Loads k_simd_width consecutive floats. No alignment is required.
+__forceinline simdf_t simdf_load(const float* p)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_loadu_ps(p);
+#elif defined(SIMD_SSE2)
+	return _mm_loadu_ps(p);
+#else
+	return *p;
+#endif
+}
+
+// Stores k_simd_width consecutive floats. No alignment is required.
+__forceinline void simdf_store(float* p, simdf_t v)
+{
+#if defined(SIMD_AVX2)
+	_mm256_storeu_ps(p, v);
+#elif defined(SIMD_SSE2)
+	_mm_storeu_ps(p, v);
+#else
+	*p = v;
+#endif
+}
+
+// Loads count floats, at most k_simd_width, and zeroes the remaining lanes.
+__forceinline simdf_t simdf_load_partial(const float* p, int count)
+{
+	if (count >= k_simd_width)
+	{
+		return simdf_load(p);
+	}
+	float lanes[k_simd_width] = { 0 };
+	for (int i = 0; i < count; ++i)
+	{
+		lanes[i] = p[i];
+	}
+	return simdf_load(lanes);
+}
+
+// Stores the first count lanes, at most k_simd_width.
+__forceinline void simdf_store_partial(float* p, simdf_t v, int count)
+{
+	if (count >= k_simd_width)
+	{
+		simdf_store(p, v);
+		return;
+	}
+	float lanes[k_simd_width];
+	simdf_store(lanes, v);
+	for (int i = 0; i < count; ++i)
+	{
+		p[i] = lanes[i];
+	}
+}
+
+__forceinline simdf_t simdf_add(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_add_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_add_ps(a, b);
+#else
+	return a + b;
+#endif
+}
+
+__forceinline simdf_t simdf_sub(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_sub_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_sub_ps(a, b);
+#else
+	return a - b;
+#endif
+}
+
+__forceinline simdf_t simdf_mul(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_mul_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_mul_ps(a, b);
+#else
+	return a * b;
+#endif
+}
+
+__forceinline simdf_t simdf_div(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_div_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_div_ps(a, b);
+#else
+	return a / b;
+#endif
+}
+
+__forceinline simdf_t simdf_sqrt(simdf_t a)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_sqrt_ps(a);
+#elif defined(SIMD_SSE2)
+	return _mm_sqrt_ps(a);
+#else
+	return sqrtf(a);
+#endif
+}
+
+__forceinline simdf_t simdf_min(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_min_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_min_ps(a, b);
+#else
+	return a < b ? a : b;
+#endif
+}
+
+__forceinline simdf_t simdf_max(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_max_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_max_ps(a, b);
+#else
+	return a > b ? a : b;
+#endif
+}
+
+// Returns a with the sign of b.
+__forceinline simdf_t simdf_copysign(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	return _mm256_or_ps(_mm256_andnot_ps(sign, a), _mm256_and_ps(sign, b));
+#elif defined(SIMD_SSE2)
+	__m128 sign = _mm_set1_ps(-0.0f);
+	return _mm_or_ps(_mm_andnot_ps(sign, a), _mm_and_ps(sign, b));
+#else
+	return copysignf(a, b);
+#endif
+}
+
+__forceinline simdf_t simdf_abs(simdf_t a)
+{
+	return simdf_copysign(a, simdf_set1(0.0f));
+}
+
+// Returns a per lane mask of a < b.
+__forceinline simdm_t simdf_lt(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+#elif defined(SIMD_SSE2)
+	return _mm_cmplt_ps(a, b);
+#else
+	return a < b;
+#endif
+}
+
+// Returns a per lane mask of a == b.
+__forceinline simdm_t simdf_eq(simdf_t a, simdf_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+#elif defined(SIMD_SSE2)
+	return _mm_cmpeq_ps(a, b);
+#else
+	return a == b;
+#endif
+}
+
+// Returns a per lane mask of lanes set in either mask.
+__forceinline simdm_t simdm_or(simdm_t a, simdm_t b)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_or_ps(a, b);
+#elif defined(SIMD_SSE2)
+	return _mm_or_ps(a, b);
+#else
+	return a || b;
+#endif
+}
+
+// Returns one bit per lane, set where the mask is set.
+__forceinline uint32_t simdm_bits(simdm_t mask)
+{
+#if defined(SIMD_AVX2)
+	return (uint32_t)_mm256_movemask_ps(mask);
+#elif defined(SIMD_SSE2)
+	return (uint32_t)_mm_movemask_ps(mask);
+#else
+	return mask ? 1 : 0;
+#endif
+}
+
+// Picks if_true in lanes where the mask is set and if_false elsewhere.
+__forceinline simdf_t simdf_select(simdm_t mask, simdf_t if_true, simdf_t if_false)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_blendv_ps(if_false, if_true, mask);
+#elif defined(SIMD_SSE2)
+	return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+#else
+	return mask ? if_true : if_false;
+#endif
+}
+
+// Rounds to the nearest integer, ties to even. Exact for magnitudes below 2^22.
+__forceinline simdf_t simdf_round(simdf_t a)
+{
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	simdf_t magic = simdf_set1(12582912.0f); // 1.5 * 2^23
+	return simdf_sub(simdf_add(a, magic), magic);
+#else
+	return rintf(a);
+#endif
+}
+
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+// Loads four floats into each 128-bit half of a vector.
+// With AVX2 the upper half comes from upper, otherwise upper is ignored.
+__forceinline simdf_t simdf_load4(const float* lower, const float* upper)
+{
+#if defined(SIMD_AVX2)
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lower)), _mm_loadu_ps(upper), 1);
+#else
+	(void)upper;
+	return _mm_loadu_ps(lower);
+#endif
+}
+
+// Stores each 128-bit half of a vector as four floats.
+// With AVX2 the upper half goes to upper, otherwise upper is ignored.
+__forceinline void simdf_store4(float* lower, float* upper, simdf_t v)
+{
+#if defined(SIMD_AVX2)
+	_mm_storeu_ps(lower, _mm256_castps256_ps128(v));
+	_mm_storeu_ps(upper, _mm256_extractf128_ps(v, 1));
+#else
+	(void)upper;
+	_mm_storeu_ps(lower, v);
+#endif
+}
+
+// Transposes the 4x4 block of floats held in each 128-bit half of four vectors.
+// Converts between four structures of four fields and one vector per field.
+__forceinline void simdf_transpose4(simdf_t* a, simdf_t* b, simdf_t* c, simdf_t* d)
+{
+#if defined(SIMD_AVX2)
+	__m256 ab_lo = _mm256_unpacklo_ps(*a, *b);
+	__m256 ab_hi = _mm256_unpackhi_ps(*a, *b);
+	__m256 cd_lo = _mm256_unpacklo_ps(*c, *d);
+	__m256 cd_hi = _mm256_unpackhi_ps(*c, *d);
+	*a = _mm256_shuffle_ps(ab_lo, cd_lo, _MM_SHUFFLE(1, 0, 1, 0));
+	*b = _mm256_shuffle_ps(ab_lo, cd_lo, _MM_SHUFFLE(3, 2, 3, 2));
+	*c = _mm256_shuffle_ps(ab_hi, cd_hi, _MM_SHUFFLE(1, 0, 1, 0));
+	*d = _mm256_shuffle_ps(ab_hi, cd_hi, _MM_SHUFFLE(3, 2, 3, 2));
+#else
+	_MM_TRANSPOSE4_PS(*a, *b, *c, *d);
+#endif
+}
+#endif
@@ -43,11 +43,6 @@ typedef struct enemy_component_t
 	int index;
 } enemy_component_t;
 
-typedef struct name_component_t
-{
-	char name[32];
-} name_component_t;
-
 typedef struct collider_component_t {
 	float width;
 	float height;
@@ -75,7 +70,6 @@ typedef struct simple_game_t
 	int camera_type;
 	int model_type;
 	int player_type;
-	int name_type;
 	int collider_type;
 	int enemy_type;
 	ecs_entity_ref_t player_ent;
@@ -107,14 +101,13 @@ simple_game_t* simple_game_create(heap_t* heap, fs_t* fs, wm_window_t* window, r
 
 	game->timer = timer_object_create(heap, NULL);
 	
-	game->ecs = ecs_create(heap);
-	game->transform_type = ecs_register_component_type(game->ecs, "transform", sizeof(transform_component_t), _Alignof(transform_component_t));
-	game->camera_type = ecs_register_component_type(game->ecs, "camera", sizeof(camera_component_t), _Alignof(camera_component_t));
-	game->model_type = ecs_register_component_type(game->ecs, "model", sizeof(model_component_t), _Alignof(model_component_t));
-	game->player_type = ecs_register_component_type(game->ecs, "player", sizeof(player_component_t), _Alignof(player_component_t));
-	game->name_type = ecs_register_component_type(game->ecs, "name", sizeof(name_component_t), _Alignof(name_component_t));
-	game->collider_type = ecs_register_component_type(game->ecs, "collider", sizeof(collider_component_t), _Alignof(collider_component_t));
-	game->enemy_type = ecs_register_component_type(game->ecs, "enemy", sizeof(enemy_component_t), _Alignof(enemy_component_t));
+	game->ecs = ecs_create(heap, 64 * 1024);
+	game->transform_type = ecs_register_component_type(game->ecs, "transform", sizeof(transform_component_t), _Alignof(transform_component_t), k_ecs_storage_paged);
+	game->camera_type = ecs_register_component_type(game->ecs, "camera", sizeof(camera_component_t), _Alignof(camera_component_t), k_ecs_storage_sparse);
+	game->model_type = ecs_register_component_type(game->ecs, "model", sizeof(model_component_t), _Alignof(model_component_t), k_ecs_storage_paged);
+	game->player_type = ecs_register_component_type(game->ecs, "player", sizeof(player_component_t), _Alignof(player_component_t), k_ecs_storage_sparse);
+	game->collider_type = ecs_register_component_type(game->ecs, "collider", sizeof(collider_component_t), _Alignof(collider_component_t), k_ecs_storage_paged);
+	game->enemy_type = ecs_register_component_type(game->ecs, "enemy", sizeof(enemy_component_t), _Alignof(enemy_component_t), k_ecs_storage_paged);
 
 	game->net = net_create(heap, game->ecs);
 	if (argc >= 2)
@@ -220,23 +213,23 @@ static void player_net_configure(ecs_t* ecs, ecs_entity_ref_t entity, int type,
 	model_component_t* model_comp = ecs_entity_get_component(ecs, entity, game->model_type, true);
 	model_comp->mesh_info = &game->cube_mesh;
 	model_comp->shader_info = &game->cube_shader;
+
+	ecs_entity_set_name(ecs, entity, "player");
 }
 
 static void spawn_player(simple_game_t* game, int index)
 {
-	uint64_t k_player_ent_mask =
-		(1ULL << game->transform_type) |
-		(1ULL << game->model_type) |
-		(1ULL << game->player_type) |
-		(1ULL << game->name_type) |
-		(1ULL << game->collider_type);
+	ecs_mask_t k_player_ent_mask = ecs_mask_none();
+	ecs_mask_add(&k_player_ent_mask, game->transform_type);
+	ecs_mask_add(&k_player_ent_mask, game->model_type);
+	ecs_mask_add(&k_player_ent_mask, game->player_type);
+	ecs_mask_add(&k_player_ent_mask, game->collider_type);
 	game->player_ent = ecs_entity_add(game->ecs, k_player_ent_mask);
 
 	transform_component_t* transform_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->transform_type, true);
 	transform_identity(&transform_comp->transform);
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "player");
+	ecs_entity_set_name(game->ecs, game->player_ent, "player");
 
 	player_component_t* player_comp = ecs_entity_get_component(game->ecs, game->player_ent, game->player_type, true);
 	player_comp->index = index;
@@ -245,12 +238,10 @@ static void spawn_player(simple_game_t* game, int index)
 	model_comp->mesh_info = &game->cube_mesh;
 	model_comp->shader_info = &game->cube_shader;
 
-	uint64_t k_player_ent_net_mask =
-		(1ULL << game->transform_type) |
-		(1ULL << game->model_type) |
-		(1ULL << game->name_type);
-	uint64_t k_player_ent_rep_mask =
-		(1ULL << game->transform_type);
+	ecs_mask_t k_player_ent_net_mask = ecs_mask_none();
+	ecs_mask_add(&k_player_ent_net_mask, game->transform_type);
+	ecs_mask_add(&k_player_ent_net_mask, game->model_type);
+	ecs_mask_t k_player_ent_rep_mask = ecs_mask_bit(game->transform_type);
 	net_state_register_entity_type(game->net, 0, k_player_ent_net_mask, k_player_ent_rep_mask, player_net_configure, game);
 
 	net_state_register_entity_instance(game->net, 0, game->player_ent);
@@ -258,13 +249,10 @@ static void spawn_player(simple_game_t* game, int index)
 
 static void spawn_camera(simple_game_t* game)
 {
-	uint64_t k_camera_ent_mask =
-		(1ULL << game->camera_type) |
-		(1ULL << game->name_type);
+	ecs_mask_t k_camera_ent_mask = ecs_mask_bit(game->camera_type);
 	game->camera_ent = ecs_entity_add(game->ecs, k_camera_ent_mask);
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "camera");
+	ecs_entity_set_name(game->ecs, game->camera_ent, "camera");
 
 	camera_component_t* camera_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->camera_type, true);
 	mat4f_make_perspective(&camera_comp->projection, (float)M_PI / 2.0f, 16.0f / 9.0f, 0.1f, 100.0f);
@@ -277,13 +265,10 @@ static void spawn_camera(simple_game_t* game)
 
 static void spawn_camera_ortho(simple_game_t* game)
 {
-	uint64_t k_camera_ent_mask =
-		(1ULL << game->camera_type) |
-		(1ULL << game->name_type);
+	ecs_mask_t k_camera_ent_mask = ecs_mask_bit(game->camera_type);
 	game->camera_ent = ecs_entity_add(game->ecs, k_camera_ent_mask);
 
-	name_component_t* name_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->name_type, true);
-	strcpy_s(name_comp->name, sizeof(name_comp->name), "camera");
+	ecs_entity_set_name(game->ecs, game->camera_ent, "camera");
 
 	camera_component_t* camera_comp = ecs_entity_get_component(game->ecs, game->camera_ent, game->camera_type, true);
 	//mat4f_make_perspective(&camera_comp->projection, (float)M_PI / 2.0f, 16.0f / 9.0f, 0.1f, 100.0f);
@@ -310,7 +295,8 @@ static int intersect(collider_component_t* comp1, collider_component_t* comp2) {
 }
 
 static void collide_check(simple_game_t* game, collider_component_t* player_col) {
-	uint64_t k_query_mask = (1ULL << game->enemy_type) | (1ULL << game->collider_type);
+	ecs_mask_t k_query_mask = ecs_mask_bit(game->enemy_type);
+	ecs_mask_add(&k_query_mask, game->collider_type);
 	for (ecs_query_t query = ecs_query_create(game->ecs, k_query_mask);
 		ecs_query_is_valid(game->ecs, &query);
 		ecs_query_next(game->ecs, &query)) {
@@ -328,7 +314,9 @@ static void update_players(simple_game_t* game)
 
 	uint32_t key_mask = wm_get_key_mask(game->window);
 
-	uint64_t k_query_mask = (1ULL << game->transform_type) | (1ULL << game->player_type) | (1ULL << game->collider_type);
+	ecs_mask_t k_query_mask = ecs_mask_bit(game->transform_type);
+	ecs_mask_add(&k_query_mask, game->player_type);
+	ecs_mask_add(&k_query_mask, game->collider_type);
 
 	for (ecs_query_t query = ecs_query_create(game->ecs, k_query_mask);
 		ecs_query_is_valid(game->ecs, &query);
@@ -374,14 +362,15 @@ static void update_players(simple_game_t* game)
 
 static void draw_models(simple_game_t* game)
 {
-	uint64_t k_camera_query_mask = (1ULL << game->camera_type);
+	ecs_mask_t k_camera_query_mask = ecs_mask_bit(game->camera_type);
 	for (ecs_query_t camera_query = ecs_query_create(game->ecs, k_camera_query_mask);
 		ecs_query_is_valid(game->ecs, &camera_query);
 		ecs_query_next(game->ecs, &camera_query))
 	{
 		camera_component_t* camera_comp = ecs_query_get_component(game->ecs, &camera_query, game->camera_type);
 
-		uint64_t k_model_query_mask = (1ULL << game->transform_type) | (1ULL << game->model_type);
+		ecs_mask_t k_model_query_mask = ecs_mask_bit(game->transform_type);
+		ecs_mask_add(&k_model_query_mask, game->model_type);
 		for (ecs_query_t query = ecs_query_create(game->ecs, k_model_query_mask);
 			ecs_query_is_valid(game->ecs, &query);
 			ecs_query_next(game->ecs, &query))
@@ -401,7 +390,7 @@ static void draw_models(simple_game_t* game)
 			transform_to_matrix(&transform_comp->transform, &uniform_data.model);
 			gpu_uniform_buffer_info_t uniform_info = { .data = &uniform_data, sizeof(uniform_data) };
 
-			render_push_model(game->render, &entity_ref, model_comp->mesh_info, model_comp->shader_info, &uniform_info);
+			render_push_model(game->render, &entity_ref, model_comp->mesh_info, model_comp->shader_info, &uniform_info, 0);
 		}
 	}
 }
@@ -30,3 +30,10 @@ void thread_sleep(uint32_t ms)
 {
 	Sleep(ms);
 }
+
+int thread_get_core_count()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
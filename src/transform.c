@@ -1,5 +1,7 @@
 #include "transform.h"
 
+#include "simd.h"
+
 void transform_identity(transform_t* transform)
 {
 	transform->translation = vec3f_zero();
@@ -50,6 +52,154 @@ void transform_to_matrix(const transform_t* transform, mat4f_t* output)
 	output->data[3][3] = 1.0f;
 }
 
+// One vector per transform field, k_simd_width transforms at a time.
+typedef struct transform_lanes_t
+{
+	simdf_t translation[3];
+	simdf_t scale[3];
+	simdf_t rotation[4];
+} transform_lanes_t;
+
+// Same arithmetic in the same order as transform_to_matrix(), so each lane matches it exactly.
+// Writes the matrix element [row][column] of every lane to m[row * 4 + column].
+static void transform_lanes_to_matrix(const transform_lanes_t* t, simdf_t m[16])
+{
+	simdf_t one = simdf_set1(1.0f);
+	simdf_t two = simdf_set1(2.0f);
+	simdf_t x = t->rotation[0];
+	simdf_t y = t->rotation[1];
+	simdf_t z = t->rotation[2];
+	simdf_t w = t->rotation[3];
+	simdf_t xx = simdf_mul(x, x);
+	simdf_t yy = simdf_mul(y, y);
+	simdf_t zz = simdf_mul(z, z);
+	simdf_t xy = simdf_mul(x, y);
+	simdf_t xz = simdf_mul(x, z);
+	simdf_t yz = simdf_mul(y, z);
+	simdf_t xw = simdf_mul(x, w);
+	simdf_t yw = simdf_mul(y, w);
+	simdf_t zw = simdf_mul(z, w);
+
+	m[0] = simdf_mul(t->scale[0], simdf_sub(one, simdf_mul(two, simdf_add(yy, zz))));
+	m[1] = simdf_mul(t->scale[0], simdf_mul(two, simdf_add(xy, zw)));
+	m[2] = simdf_mul(t->scale[0], simdf_mul(two, simdf_sub(xz, yw)));
+	m[3] = simdf_set1(0.0f);
+	m[4] = simdf_mul(t->scale[1], simdf_mul(two, simdf_sub(xy, zw)));
+	m[5] = simdf_mul(t->scale[1], simdf_sub(one, simdf_mul(two, simdf_add(xx, zz))));
+	m[6] = simdf_mul(t->scale[1], simdf_mul(two, simdf_add(yz, xw)));
+	m[7] = m[3];
+	m[8] = simdf_mul(t->scale[2], simdf_mul(two, simdf_add(xz, yw)));
+	m[9] = simdf_mul(t->scale[2], simdf_mul(two, simdf_sub(yz, xw)));
+	m[10] = simdf_mul(t->scale[2], simdf_sub(one, simdf_mul(two, simdf_add(xx, yy))));
+	m[11] = m[3];
+	m[12] = t->translation[0];
+	m[13] = t->translation[1];
+	m[14] = t->translation[2];
+	m[15] = one;
+}
+
+// Write k_simd_width matrices from one vector per matrix element.
+static void store_matrix_lanes(simdf_t m[16], mat4f_t* outputs)
+{
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	// Transposing a row's four elements gives that row for four matrices; with AVX2 the
+	// upper half of each vector belongs to the matrix four further on.
+	for (int row = 0; row < 4; ++row)
+	{
+		simdf_t* r = &m[row * 4];
+		simdf_transpose4(&r[0], &r[1], &r[2], &r[3]);
+		for (int i = 0; i < 4; ++i)
+		{
+			simdf_store4(outputs[i].data[row], outputs[i + k_simd_width - 4].data[row], r[i]);
+		}
+	}
+#else
+	for (int i = 0; i < 16; ++i)
+	{
+		outputs->data[i >> 2][i & 3] = m[i];
+	}
+#endif
+}
+
+void transform_to_matrix_batch(const transform_t* transforms, mat4f_t* outputs, int count)
+{
+	int i = 0;
+	for (; i + k_simd_width <= count; i += k_simd_width)
+	{
+		const transform_t* t = &transforms[i];
+		transform_lanes_t lanes;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+		// A transform is ten floats. Transposing four loads from each of three offsets gathers
+		// translation, scale, and rotation into one vector per field; the fourth vector of the
+		// first two transposes repeats a neighbouring field and is discarded.
+		const int k_offsets[3] = { 0, 3, 6 };
+		simdf_t fields[3][4];
+		for (int f = 0; f < 3; ++f)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				fields[f][j] = simdf_load4((const float*)&t[j] + k_offsets[f], (const float*)&t[j + k_simd_width - 4] + k_offsets[f]);
+			}
+			simdf_transpose4(&fields[f][0], &fields[f][1], &fields[f][2], &fields[f][3]);
+		}
+		for (int j = 0; j < 3; ++j)
+		{
+			lanes.translation[j] = fields[0][j];
+			lanes.scale[j] = fields[1][j];
+		}
+		for (int j = 0; j < 4; ++j)
+		{
+			lanes.rotation[j] = fields[2][j];
+		}
+#else
+		lanes = (transform_lanes_t)
+		{
+			.translation = { t->translation.x, t->translation.y, t->translation.z },
+			.scale = { t->scale.x, t->scale.y, t->scale.z },
+			.rotation = { t->rotation.x, t->rotation.y, t->rotation.z, t->rotation.w },
+		};
+#endif
+		simdf_t m[16];
+		transform_lanes_to_matrix(&lanes, m);
+		store_matrix_lanes(m, &outputs[i]);
+	}
+	for (; i < count; ++i)
+	{
+		transform_to_matrix(&transforms[i], &outputs[i]);
+	}
+}
+
+void transform_to_matrix_batch_soa(const transform_soa_t* transforms, mat4f_t* outputs, int count)
+{
+	int i = 0;
+	for (; i + k_simd_width <= count; i += k_simd_width)
+	{
+		transform_lanes_t lanes;
+		for (int j = 0; j < 3; ++j)
+		{
+			lanes.translation[j] = simdf_load(&transforms->translation[j][i]);
+			lanes.scale[j] = simdf_load(&transforms->scale[j][i]);
+		}
+		for (int j = 0; j < 4; ++j)
+		{
+			lanes.rotation[j] = simdf_load(&transforms->rotation[j][i]);
+		}
+		simdf_t m[16];
+		transform_lanes_to_matrix(&lanes, m);
+		store_matrix_lanes(m, &outputs[i]);
+	}
+	for (; i < count; ++i)
+	{
+		transform_t t =
+		{
+			.translation = { .x = transforms->translation[0][i], .y = transforms->translation[1][i], .z = transforms->translation[2][i] },
+			.scale = { .x = transforms->scale[0][i], .y = transforms->scale[1][i], .z = transforms->scale[2][i] },
+			.rotation = { .x = transforms->rotation[0][i], .y = transforms->rotation[1][i], .z = transforms->rotation[2][i], .w = transforms->rotation[3][i] },
+		};
+		transform_to_matrix(&t, &outputs[i]);
+	}
+}
+
 void transform_multiply(transform_t* result, const transform_t* t)
 {
 	const vec3f_t scaled_translation = vec3f_mul(result->translation, t->scale);
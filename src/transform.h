@@ -21,6 +21,23 @@ void transform_identity(transform_t* transform);
 // Convert a transform to a matrix representation.
 void transform_to_matrix(const transform_t* transform, mat4f_t* output);
 
+// Transforms stored as one array per field, for batch conversion.
+// Each array holds one value per transform: translation[0] is every x translation, and so on.
+typedef struct transform_soa_t
+{
+	const float* translation[3];
+	const float* scale[3];
+	const float* rotation[4];
+} transform_soa_t;
+
+// Convert count transforms to matrices.
+// Same results as calling transform_to_matrix() on each, computed several transforms at a time with SIMD.
+void transform_to_matrix_batch(const transform_t* transforms, mat4f_t* outputs, int count);
+
+// Convert count transforms stored as arrays of fields to matrices.
+// Faster than transform_to_matrix_batch() because no transposing is needed to load the fields.
+void transform_to_matrix_batch_soa(const transform_soa_t* transforms, mat4f_t* outputs, int count);
+
 // Combine to transforms -- result and t -- and store the output in result.
 void transform_multiply(transform_t* result, const transform_t* t);
 
@@ -0,0 +1,295 @@
+#include "transform_hierarchy.h"
+
+#include "heap.h"
+
+#include <string.h>
+
+typedef struct transform_hierarchy_t
+{
+	heap_t* heap;
+	ecs_t* ecs;
+	int local_type;
+	int parent_type;
+	int world_type;
+
+	int query;
+	int parent_query;
+	uint32_t query_version;
+	uint32_t parent_query_version;
+	uint32_t since_version;
+	bool needs_sort;
+
+	// Entities in parent-before-child order.
+	// Parents are indices into the same order, or -1 for roots.
+	int count;
+	int capacity;
+	ecs_entity_ref_t* entities;
+	int* parents;
+	bool* dirty;
+	mat4f_t* worlds;
+
+	// Local transforms of the dirty entities, converted to matrices in one batch.
+	int* dirty_indices;
+	transform_t* dirty_locals;
+	mat4f_t* dirty_matrices;
+} transform_hierarchy_t;
+
+transform_hierarchy_t* transform_hierarchy_create(heap_t* heap, ecs_t* ecs, int local_type)
+{
+	transform_hierarchy_t* hierarchy = heap_alloc(heap, sizeof(transform_hierarchy_t), 8);
+	memset(hierarchy, 0, sizeof(*hierarchy));
+	hierarchy->heap = heap;
+	hierarchy->ecs = ecs;
+	hierarchy->local_type = local_type;
+	hierarchy->parent_type = ecs_register_component_type(ecs, "transform_parent", sizeof(transform_parent_component_t), _Alignof(transform_parent_component_t), k_ecs_storage_sparse);
+	hierarchy->world_type = ecs_register_component_type(ecs, "transform_world", sizeof(transform_world_component_t), _Alignof(transform_world_component_t), k_ecs_storage_paged);
+
+	ecs_mask_t mask = ecs_mask_bit(local_type);
+	ecs_mask_add(&mask, hierarchy->world_type);
+	hierarchy->query = ecs_query_register(ecs, mask);
+	ecs_mask_add(&mask, hierarchy->parent_type);
+	hierarchy->parent_query = ecs_query_register(ecs, mask);
+	hierarchy->needs_sort = true;
+	return hierarchy;
+}
+
+static void free_arrays(transform_hierarchy_t* hierarchy)
+{
+	if (hierarchy->entities)
+	{
+		heap_free(hierarchy->heap, hierarchy->entities);
+		heap_free(hierarchy->heap, hierarchy->parents);
+		heap_free(hierarchy->heap, hierarchy->dirty);
+		heap_free(hierarchy->heap, hierarchy->worlds);
+		heap_free(hierarchy->heap, hierarchy->dirty_indices);
+		heap_free(hierarchy->heap, hierarchy->dirty_locals);
+		heap_free(hierarchy->heap, hierarchy->dirty_matrices);
+	}
+}
+
+void transform_hierarchy_destroy(transform_hierarchy_t* hierarchy)
+{
+	free_arrays(hierarchy);
+	heap_free(hierarchy->heap, hierarchy);
+}
+
+int transform_hierarchy_get_parent_type(transform_hierarchy_t* hierarchy)
+{
+	return hierarchy->parent_type;
+}
+
+int transform_hierarchy_get_world_type(transform_hierarchy_t* hierarchy)
+{
+	return hierarchy->world_type;
+}
+
+bool transform_hierarchy_set_local(transform_hierarchy_t* hierarchy, ecs_entity_ref_t entity, const transform_t* transform)
+{
+	// Reading does not stamp the component's version, so an unchanged transform stays clean.
+	const transform_t* local = ecs_entity_read_component(hierarchy->ecs, entity, hierarchy->local_type, false);
+	if (!local || memcmp(local, transform, sizeof(*transform)) == 0)
+	{
+		return false;
+	}
+	*(transform_t*)ecs_entity_get_component(hierarchy->ecs, entity, hierarchy->local_type, false) = *transform;
+	return true;
+}
+
+static void reserve(transform_hierarchy_t* hierarchy, int count)
+{
+	if (count <= hierarchy->capacity)
+	{
+		return;
+	}
+	free_arrays(hierarchy);
+	int capacity = __max(count, hierarchy->capacity * 2);
+	hierarchy->entities = heap_alloc(hierarchy->heap, sizeof(ecs_entity_ref_t) * capacity, 8);
+	hierarchy->parents = heap_alloc(hierarchy->heap, sizeof(int) * capacity, 8);
+	hierarchy->dirty = heap_alloc(hierarchy->heap, sizeof(bool) * capacity, 8);
+	hierarchy->worlds = heap_alloc(hierarchy->heap, sizeof(mat4f_t) * capacity, 16);
+	hierarchy->dirty_indices = heap_alloc(hierarchy->heap, sizeof(int) * capacity, 8);
+	hierarchy->dirty_locals = heap_alloc(hierarchy->heap, sizeof(transform_t) * capacity, 8);
+	hierarchy->dirty_matrices = heap_alloc(hierarchy->heap, sizeof(mat4f_t) * capacity, 16);
+	hierarchy->capacity = capacity;
+}
+
+// Rebuild the entity order breadth-first from the roots, so every parent comes before its children
+// and each level of the hierarchy is contiguous.
+static void sort_entities(transform_hierarchy_t* hierarchy)
+{
+	ecs_t* ecs = hierarchy->ecs;
+	heap_t* heap = hierarchy->heap;
+
+	int count = 0;
+	int entity_limit = 0;
+	for (ecs_query_t query = ecs_query_create_registered(ecs, hierarchy->query); ecs_query_is_valid(ecs, &query); ecs_query_next(ecs, &query))
+	{
+		count++;
+		entity_limit = __max(entity_limit, query.entity + 1);
+	}
+	reserve(hierarchy, count);
+	hierarchy->count = count;
+	if (count == 0)
+	{
+		return;
+	}
+
+	ecs_entity_ref_t* members = heap_alloc(heap, sizeof(ecs_entity_ref_t) * count, 8);
+	int* member_of_entity = heap_alloc(heap, sizeof(int) * entity_limit, 8);
+	int* parent_of = heap_alloc(heap, sizeof(int) * count, 8);
+	int* first_child = heap_alloc(heap, sizeof(int) * (count + 1), 8);
+	int* children = heap_alloc(heap, sizeof(int) * count, 8);
+	int* order = heap_alloc(heap, sizeof(int) * count, 8);
+	int* rank = heap_alloc(heap, sizeof(int) * count, 8);
+
+	memset(member_of_entity, 0xff, sizeof(int) * entity_limit);
+	int m = 0;
+	for (ecs_query_t query = ecs_query_create_registered(ecs, hierarchy->query); ecs_query_is_valid(ecs, &query); ecs_query_next(ecs, &query))
+	{
+		members[m] = ecs_query_get_entity(ecs, &query);
+		member_of_entity[query.entity] = m;
+		m++;
+	}
+
+	// Find each member's parent among the members and count children per parent.
+	memset(first_child, 0, sizeof(int) * (count + 1));
+	for (int i = 0; i < count; ++i)
+	{
+		const transform_parent_component_t* parent_comp = ecs_entity_read_component(ecs, members[i], hierarchy->parent_type, false);
+		int parent = -1;
+		if (parent_comp && ecs_is_entity_ref_valid(ecs, parent_comp->parent, false) && parent_comp->parent.entity < entity_limit)
+		{
+			parent = member_of_entity[parent_comp->parent.entity];
+		}
+		parent_of[i] = parent != i ? parent : -1;
+		if (parent_of[i] >= 0)
+		{
+			first_child[parent_of[i] + 1]++;
+		}
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		first_child[i + 1] += first_child[i];
+	}
+	int* next_child = rank;
+	memcpy(next_child, first_child, sizeof(int) * count);
+	for (int i = 0; i < count; ++i)
+	{
+		if (parent_of[i] >= 0)
+		{
+			children[next_child[parent_of[i]]++] = i;
+		}
+	}
+
+	// Breadth-first from the roots. Members on a parent cycle are never reached; they become roots.
+	int ordered = 0;
+	int head = 0;
+	memset(rank, 0xff, sizeof(int) * count);
+	for (int pass = 0; pass < 2 && ordered < count; ++pass)
+	{
+		for (int root = 0; root < count; ++root)
+		{
+			if (rank[root] >= 0 || (pass == 0 && parent_of[root] >= 0))
+			{
+				continue;
+			}
+			parent_of[root] = -1;
+			rank[root] = ordered;
+			order[ordered++] = root;
+			while (head < ordered)
+			{
+				int node = order[head++];
+				for (int c = first_child[node]; c < first_child[node + 1]; ++c)
+				{
+					if (rank[children[c]] < 0)
+					{
+						rank[children[c]] = ordered;
+						order[ordered++] = children[c];
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		int member = order[i];
+		hierarchy->entities[i] = members[member];
+		hierarchy->parents[i] = parent_of[member] >= 0 ? rank[parent_of[member]] : -1;
+	}
+
+	heap_free(heap, rank);
+	heap_free(heap, order);
+	heap_free(heap, children);
+	heap_free(heap, first_child);
+	heap_free(heap, parent_of);
+	heap_free(heap, member_of_entity);
+	heap_free(heap, members);
+}
+
+void transform_hierarchy_update(transform_hierarchy_t* hierarchy)
+{
+	ecs_t* ecs = hierarchy->ecs;
+	uint32_t since = hierarchy->since_version;
+	hierarchy->since_version = ecs_version_checkpoint(ecs);
+
+	// Re-sort when entities join or leave, or when any parent link is added, removed or changed.
+	uint32_t query_version = ecs_query_get_registered_version(ecs, hierarchy->query);
+	uint32_t parent_query_version = ecs_query_get_registered_version(ecs, hierarchy->parent_query);
+	if (query_version != hierarchy->query_version || parent_query_version != hierarchy->parent_query_version)
+	{
+		hierarchy->needs_sort = true;
+	}
+	else
+	{
+		ecs_query_t query = ecs_query_create_registered_changed(ecs, hierarchy->parent_query, hierarchy->parent_type, since);
+		hierarchy->needs_sort |= ecs_query_is_valid(ecs, &query);
+	}
+
+	bool sorted = hierarchy->needs_sort;
+	if (sorted)
+	{
+		sort_entities(hierarchy);
+		hierarchy->query_version = query_version;
+		hierarchy->parent_query_version = parent_query_version;
+		hierarchy->needs_sort = false;
+	}
+
+	// Gather the dirty entities' local transforms and convert them all at once.
+	int dirty_count = 0;
+	for (int i = 0; i < hierarchy->count; ++i)
+	{
+		ecs_entity_ref_t entity = hierarchy->entities[i];
+		int parent = hierarchy->parents[i];
+		bool dirty = sorted ||
+			ecs_entity_get_component_version(ecs, entity, hierarchy->local_type) > since ||
+			(parent >= 0 && hierarchy->dirty[parent]);
+		hierarchy->dirty[i] = dirty;
+		if (dirty)
+		{
+			hierarchy->dirty_locals[dirty_count] = *(const transform_t*)ecs_entity_read_component(ecs, entity, hierarchy->local_type, false);
+			hierarchy->dirty_indices[dirty_count] = i;
+			dirty_count++;
+		}
+	}
+	transform_to_matrix_batch(hierarchy->dirty_locals, hierarchy->dirty_matrices, dirty_count);
+
+	// Dirty entities stay in parent-before-child order, so each parent's world matrix is ready first.
+	for (int d = 0; d < dirty_count; ++d)
+	{
+		int i = hierarchy->dirty_indices[d];
+		int parent = hierarchy->parents[i];
+		if (parent >= 0)
+		{
+			mat4f_mul(&hierarchy->worlds[i], &hierarchy->dirty_matrices[d], &hierarchy->worlds[parent]);
+		}
+		else
+		{
+			hierarchy->worlds[i] = hierarchy->dirty_matrices[d];
+		}
+
+		transform_world_component_t* world = ecs_entity_get_component(ecs, hierarchy->entities[i], hierarchy->world_type, false);
+		world->matrix = hierarchy->worlds[i];
+		world->version = ecs_entity_get_component_version(ecs, hierarchy->entities[i], hierarchy->world_type);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Transform Hierarchy
+// Computes world matrices for entities whose local transforms may be attached to parent entities.
+
+#include "ecs.h"
+#include "mat4f.h"
+#include "transform.h"
+
+// Handle to a transform hierarchy.
+typedef struct transform_hierarchy_t transform_hierarchy_t;
+
+typedef struct heap_t heap_t;
+
+// Attaches an entity's local transform to a parent entity.
+// Entities without a parent component, or whose parent is gone, are roots.
+typedef struct transform_parent_component_t
+{
+	ecs_entity_ref_t parent;
+} transform_parent_component_t;
+
+// World matrix computed from an entity's local transform and those of its parents.
+// Cached between updates; only recomputed when the entity or one of its parents is dirty.
+typedef struct transform_world_component_t
+{
+	mat4f_t matrix;
+	// Entity system version at which the matrix last changed.
+	// Readers that save it can skip work for matrices that have not changed since.
+	uint32_t version;
+} transform_world_component_t;
+
+// Create a transform hierarchy over entities with both a local_type and a world component.
+// Components of local_type must begin with a transform_t.
+// Registers the parent and world component types with the entity system.
+transform_hierarchy_t* transform_hierarchy_create(heap_t* heap, ecs_t* ecs, int local_type);
+
+// Destroy a transform hierarchy.
+void transform_hierarchy_destroy(transform_hierarchy_t* hierarchy);
+
+// Return the component type of transform_parent_component_t.
+int transform_hierarchy_get_parent_type(transform_hierarchy_t* hierarchy);
+
+// Return the component type of transform_world_component_t.
+int transform_hierarchy_get_world_type(transform_hierarchy_t* hierarchy);
+
+// Write an entity's local transform, marking it dirty only if the value changed.
+// Writes that leave the transform as it was cost no matrix rebuild in the next update.
+// Returns true if the transform changed.
+bool transform_hierarchy_set_local(transform_hierarchy_t* hierarchy, ecs_entity_ref_t entity, const transform_t* transform);
+
+// Recompute world matrices in one pass over entities kept in parent-before-child order.
+// Only dirty entities, those whose local transform was written since the last update, and their children
+// are recomputed. Clean entities keep their cached world matrix and version.
+// Reads local and parent components; writes world components.
+void transform_hierarchy_update(transform_hierarchy_t* hierarchy);
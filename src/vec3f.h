@@ -13,6 +13,14 @@ typedef struct vec3f_t
 	};
 } vec3f_t;
 
+// Vectors stored as one array per component, for batch functions.
+typedef struct vec3f_soa_t
+{
+	float* x;
+	float* y;
+	float* z;
+} vec3f_soa_t;
+
 __forceinline vec3f_t vec3f_x()
 {
 	return (vec3f_t) { .x = 1.0f };